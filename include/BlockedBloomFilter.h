@@ -0,0 +1,256 @@
+#ifndef BLOCKED_BLOOM_FILTER_H
+#define BLOCKED_BLOOM_FILTER_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "BloomHash.h" // 128-bit hashing shared with BloomFilter
+#include "CDNServer.h" // Default backend for checking definitively if an item is in the dataset
+#include "LookupBackend.h"
+#include "WordFile.h"  // Parsing of ", "-separated word files
+
+// Cache-line-blocked Bloom filter: the first half of an item's hash picks one 64-byte block and all K
+// bits of the item are set inside that block, so every query touches exactly one cache line.
+// The price is a slightly higher false-positive rate than BloomFilter<N> for the same N and K,
+// because blocks do not fill evenly. Drop-in replacement for BloomFilter with the same API.
+template <std::size_t N = 81920, std::size_t K = 3>  // N is rounded up to whole 512-bit blocks
+class BlockedBloomFilter {
+public:
+    static constexpr std::size_t block_bits = 512;  // One 64-byte cache line
+    static constexpr std::size_t num_blocks = (N + block_bits - 1) / block_bits;
+
+    static_assert(K > 0, "BlockedBloomFilter needs at least one hash function");
+
+    // Constructor creating an empty filter backed by its own CDNServer
+    BlockedBloomFilter();
+    // Constructor creating an empty filter backed by "backend", which may be shared or null for none
+    explicit BlockedBloomFilter(std::shared_ptr<LookupBackend> backend);
+
+    // Copy and move constructors, a copy shares the backend of "other"
+    BlockedBloomFilter(const BlockedBloomFilter& other);
+    BlockedBloomFilter(BlockedBloomFilter&& other) noexcept;
+
+    // Assignment operators, sharing or taking over the backend of "other"
+    BlockedBloomFilter& operator=(const BlockedBloomFilter& other);
+    BlockedBloomFilter& operator=(BlockedBloomFilter&& other) noexcept;
+
+    // Destructor
+    ~BlockedBloomFilter();
+
+    // Add an item to the filter
+    void add(const std::string& item);
+    // Overload for adding items from a file, where words are assumed to be separated by ", "
+    // If no such file can be opened the argument itself is added as an item
+    void add(std::string&& file_name="../Resource/Word_DataSet_1.txt");
+
+    // Check if an item might be in the filter
+    bool possiblyContains(const std::string& item) const;
+    // Overload for r-value references, forwards to the l-value reference version
+    bool possiblyContains(std::string&& item) const;
+    // Overloads for views and C strings, which are checked without allocating
+    bool possiblyContains(std::string_view item) const;
+    bool possiblyContains(const char* item) const;
+
+    // Definitive check for an item's presence combining the filter and CDNServer
+    bool certainlyContains(const std::string& item) const;
+    // Overload for r-value strings
+    bool certainlyContains(std::string&& item) const;
+    // Overloads for views and C strings, which are checked without allocating
+    bool certainlyContains(std::string_view item) const;
+    bool certainlyContains(const char* item) const;
+
+    // Reset the filter, clearing all set bits
+    void reset();
+
+    // Operator overloads for combining filters; the result shares the backend of the left operand
+    BlockedBloomFilter operator&(const BlockedBloomFilter& other) const; // Intersection of two filters
+    BlockedBloomFilter operator|(const BlockedBloomFilter& other) const; // Union of two filters
+    // In-place intersection and union
+    BlockedBloomFilter& operator&=(const BlockedBloomFilter& other);
+    BlockedBloomFilter& operator|=(const BlockedBloomFilter& other);
+
+    // Operator to check direct access, same as possiblyContains
+    bool operator()(std::string_view item) const;
+
+    // Store consulted by the definitive checks, null for a moved-from filter
+    const std::shared_ptr<LookupBackend>& backend() const { return server; }
+
+private:
+    // One cache line worth of bits
+    struct alignas(64) Block {
+        std::array<std::uint64_t, block_bits / 64> words{};
+    };
+
+    // Bit array split into cache-line-sized blocks
+    std::array<Block, num_blocks> blocks{};
+
+    // Backend used to definitively check items, possibly shared with other filters
+    std::shared_ptr<LookupBackend> server;
+
+    // Block selected by the item's hash
+    static std::size_t blockIndex(const Hash128& h) {
+        return static_cast<std::size_t>(h.h1 % num_blocks);
+    }
+
+    // Position inside the block of the i-th probe, double hashing on the two halves of h2. Bit 0 of h2 is
+    // always set by hash128, so it is skipped: with it every probe would be stuck on one parity of bits
+    static std::size_t bitIndex(const Hash128& h, std::size_t i) {
+        const std::uint32_t a = static_cast<std::uint32_t>(h.h2 >> 1);
+        const std::uint32_t b = static_cast<std::uint32_t>(h.h2 >> 33) | 1u;
+        return (a + static_cast<std::uint32_t>(i) * b) & (block_bits - 1);
+    }
+
+    // Sets the bits of "item" and registers it with the server, shared by every add overload
+    void insert(std::string_view item);
+};
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>::BlockedBloomFilter() : server(std::make_shared<CDNServer>()) {}
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>::BlockedBloomFilter(std::shared_ptr<LookupBackend> backend) : server(std::move(backend)) {}
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>::BlockedBloomFilter(const BlockedBloomFilter& other) = default;
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>::BlockedBloomFilter(BlockedBloomFilter&& other) noexcept = default;
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>& BlockedBloomFilter<N, K>::operator=(const BlockedBloomFilter& other) = default;
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>& BlockedBloomFilter<N, K>::operator=(BlockedBloomFilter&& other) noexcept = default;
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>::~BlockedBloomFilter() = default;
+
+template <std::size_t N, std::size_t K>
+void BlockedBloomFilter<N, K>::add(const std::string& item) {
+    insert(item);
+}
+
+template <std::size_t N, std::size_t K>
+void BlockedBloomFilter<N, K>::insert(std::string_view item) {
+    const Hash128 h = hash128(item);
+    Block& block = blocks[blockIndex(h)];
+    for (std::size_t i = 0; i < K; ++i) {
+        const std::size_t bit = bitIndex(h, i);
+        block.words[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    }
+    if (server) {
+        server->addWord(item);
+    }
+}
+
+template <std::size_t N, std::size_t K>
+void BlockedBloomFilter<N, K>::add(std::string&& file_name) {
+    const bool loaded = forEachWordInFile(file_name, [this](std::string_view word) {
+        insert(word);
+    });
+    if (!loaded) {
+        add(static_cast<const std::string&>(file_name));
+    }
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::possiblyContains(const std::string& item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::possiblyContains(std::string_view item) const {
+    const Hash128 h = hash128(item);
+    const Block& block = blocks[blockIndex(h)];
+    // Build the item's mask per word first so the test is branch-free within the cache line
+    std::array<std::uint64_t, block_bits / 64> mask{};
+    for (std::size_t i = 0; i < K; ++i) {
+        const std::size_t bit = bitIndex(h, i);
+        mask[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    }
+    std::uint64_t missing = 0;
+    for (std::size_t w = 0; w < mask.size(); ++w) {
+        missing |= mask[w] & ~block.words[w];
+    }
+    return missing == 0;
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::possiblyContains(std::string&& item) const {
+    return possiblyContains(static_cast<const std::string&>(item));
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::possiblyContains(const char* item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::certainlyContains(const std::string& item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::certainlyContains(std::string&& item) const {
+    return certainlyContains(static_cast<const std::string&>(item));
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::certainlyContains(std::string_view item) const {
+    // Only items that pass the probabilistic check ever reach the server
+    return possiblyContains(item) && server && server->checkWord(item);
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::certainlyContains(const char* item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+template <std::size_t N, std::size_t K>
+void BlockedBloomFilter<N, K>::reset() {
+    blocks.fill(Block{});
+}
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K> BlockedBloomFilter<N, K>::operator&(const BlockedBloomFilter& other) const {
+    BlockedBloomFilter result(*this);
+    result &= other;
+    return result;
+}
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K> BlockedBloomFilter<N, K>::operator|(const BlockedBloomFilter& other) const {
+    BlockedBloomFilter result(*this);
+    result |= other;
+    return result;
+}
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>& BlockedBloomFilter<N, K>::operator&=(const BlockedBloomFilter& other) {
+    for (std::size_t b = 0; b < num_blocks; ++b) {
+        for (std::size_t w = 0; w < block_bits / 64; ++w) {
+            blocks[b].words[w] &= other.blocks[b].words[w];
+        }
+    }
+    return *this;
+}
+
+template <std::size_t N, std::size_t K>
+BlockedBloomFilter<N, K>& BlockedBloomFilter<N, K>::operator|=(const BlockedBloomFilter& other) {
+    for (std::size_t b = 0; b < num_blocks; ++b) {
+        for (std::size_t w = 0; w < block_bits / 64; ++w) {
+            blocks[b].words[w] |= other.blocks[b].words[w];
+        }
+    }
+    return *this;
+}
+
+template <std::size_t N, std::size_t K>
+bool BlockedBloomFilter<N, K>::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+#endif // BLOCKED_BLOOM_FILTER_H
@@ -3,54 +3,250 @@
 
 #include <vector>
 #include <functional>  // Included for std::hash
-#include <bitset>      // Included for std::bitset
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 
-#include "CDNServer.h" // Dependency for checking definitively if an item is in the dataset
+#include "BloomHash.h" // 128-bit hashing used by the double-hashing scheme
+#include "CDNServer.h" // Default backend for checking definitively if an item is in the dataset
+#include "LookupBackend.h"
+#include "LookupStats.h" // Optional operation counters and latency histograms
+#include "MemoryUsage.h"
+#include "WordFile.h"  // Parsing of ", "-separated word files
+
+namespace bloom_filter_detail {
+
+// Clears alive[j] for every j < count whose bit positions[j] is not set in "words".
+// Dispatches at runtime to an AVX2 gather kernel when available, otherwise uses NEON or scalar code
+void testBits(const std::uint64_t* words, const std::uint64_t* positions, std::size_t count, std::uint8_t* alive);
+
+// Number of set bits in words[0, count), and in the bitwise OR of "a" and "b" over the same range.
+// Dispatch at runtime to the POPCNT instruction when the CPU has it
+std::size_t countBits(const std::uint64_t* words, std::size_t count);
+std::size_t countUnionBits(const std::uint64_t* a, const std::uint64_t* b, std::size_t count);
+
+// Swamidass-Baldi estimate of the distinct items behind "set_bits" of "num_bits" bits set with
+// "num_hashes" probes each, -(m / k) ln(1 - X / m); infinite once every bit is set
+inline double estimateItems(std::size_t set_bits, std::size_t num_bits, std::size_t num_hashes) {
+    const double m = static_cast<double>(num_bits);
+    return -m / static_cast<double>(num_hashes) * std::log1p(-static_cast<double>(set_bits) / m);
+}
+
+} // namespace bloom_filter_detail
+
+// On-disk format of a saved BloomFilter, laid out so that the bit words can be used in place from a
+// memory mapping (see MappedBloomFilter): a 64-byte Header, the seeds padded to a multiple of 64 bytes,
+// then the bit words. Integers are stored in native byte order.
+namespace bloom_file {
+
+constexpr char magic[8] = {'B', 'L', 'O', 'O', 'M', 'F', 'L', 'T'};
+constexpr std::uint32_t version = 1;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;     // Format version, bumped on any layout change
+    std::uint32_t scheme;      // HashScheme the positions were derived with
+    std::uint64_t num_bits;    // N of the filter that wrote the file
+    std::uint64_t num_hashes;  // Number of hash functions, and of stored seeds
+    std::uint64_t checksum;    // Of the seeds and bit words, see checksum()
+    std::uint64_t reserved[3];
+};
+static_assert(sizeof(Header) == 64, "bloom_file::Header must fill exactly one cache line");
+
+inline std::size_t seedsBytes(std::uint64_t num_hashes) {
+    return static_cast<std::size_t>((num_hashes * sizeof(std::uint64_t) + 63) / 64 * 64);
+}
+
+inline std::size_t wordsBytes(std::uint64_t num_bits) {
+    return static_cast<std::size_t>((num_bits + 63) / 64 * sizeof(std::uint64_t));
+}
+
+inline std::uint64_t checksum(std::string_view seeds, std::string_view words) {
+    return hash128(words, hash128(seeds).h1).h1;
+}
+
+// Validates "bytes" as a saved filter of "num_bits" bits and returns its header.
+// Throws std::runtime_error describing the first mismatch
+inline Header validate(std::string_view bytes, std::size_t num_bits, bool verify_checksum = true) {
+    Header header;
+    if (bytes.size() < sizeof(Header)) {
+        throw std::runtime_error("BloomFilter file: truncated header");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(Header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version) {
+        throw std::runtime_error("BloomFilter file: not a Bloom filter or unsupported format version");
+    }
+    if (header.num_bits != num_bits) {
+        throw std::runtime_error("BloomFilter file: written for " + std::to_string(header.num_bits) +
+                                 " bits, expected " + std::to_string(num_bits));
+    }
+    if (header.num_hashes == 0 || header.scheme > static_cast<std::uint32_t>(HashScheme::DoubleHashing)) {
+        throw std::runtime_error("BloomFilter file: invalid hash parameters");
+    }
+    const std::size_t seeds_size = seedsBytes(header.num_hashes);
+    if (bytes.size() != sizeof(Header) + seeds_size + wordsBytes(num_bits)) {
+        throw std::runtime_error("BloomFilter file: size does not match its header");
+    }
+    if (verify_checksum &&
+        header.checksum != checksum(bytes.substr(sizeof(Header), seeds_size), bytes.substr(sizeof(Header) + seeds_size))) {
+        throw std::runtime_error("BloomFilter file: checksum mismatch");
+    }
+    return header;
+}
+
+} // namespace bloom_file
+
+template <std::size_t N>
+class CountingBloomFilter;
 
 // BloomFilter class template for probabilistic set membership checking
 template <std::size_t N = 81920>  // Default size of the Bloom filter bit array set to 81920 bits (10 kilobytes)
 class BloomFilter {
 public:
-    // Constructor initializing the number of hash functions
-    BloomFilter(unsigned int num_hashes);
+    // Constructor initializing the number of hash functions and the scheme used to derive bit positions.
+    // HashScheme::Seeded reproduces the answers of filters built before double hashing was introduced.
+    // The filter is backed by a CDNServer of its own.
+    BloomFilter(unsigned int num_hashes, HashScheme scheme = HashScheme::DoubleHashing);
+    // Same, but backed by "backend", which may be shared with other filters or be null for none
+    BloomFilter(unsigned int num_hashes, std::shared_ptr<LookupBackend> backend,
+                HashScheme scheme = HashScheme::DoubleHashing);
 
-    // Copy constructor
+    // Copy constructor, the copy shares the backend of "other"
     BloomFilter(const BloomFilter& other);
 
     // Move constructor with noexcept specifier for optimal performance
     BloomFilter(BloomFilter&& other) noexcept;
 
+    // Assignment operators, sharing or taking over the backend of "other"
+    BloomFilter& operator=(const BloomFilter& other);
+    BloomFilter& operator=(BloomFilter&& other) noexcept;
+
     // Destructor
     ~BloomFilter();
 
     // Add an item to the Bloom filter
     void add(const std::string& item);
     // Overload for adding items from a file, where words are assumed to be separated by ", "
+    // If no such file can be opened the argument itself is added as an item
     void add(std::string&& file_name="../Resource/Word_DataSet_1.txt");
+    // Adds every word of a ", "-separated file, tokenized straight from a memory mapping of it.
+    // With "populate_server" false the words only go into the filter. Returns the number of words read
+    // and throws std::runtime_error if the file cannot be opened
+    // With "num_threads" above one the words are hashed in parallel as by addAll
+    std::size_t addFile(const std::string& file_name, bool populate_server = true, unsigned int num_threads = 1);
+
+    // Bulk insert of a random-access range of strings or string views using "num_threads" threads.
+    // Every thread sets the bits of its slice in a private bit array and the partial arrays are OR-ed
+    // into this filter at the end, exactly like operator|, so no atomics are needed. The calling thread
+    // registers the items with the server meanwhile unless "populate_server" is false.
+    template <std::ranges::random_access_range Range>
+    void addAll(const Range& items, unsigned int num_threads = std::thread::hardware_concurrency(),
+                bool populate_server = true);
 
     // Check if an item might be in the Bloom filter
     bool possiblyContains(const std::string& item) const;
     // Overload for r-value references, forwards to the l-value reference version
     bool possiblyContains(std::string&& item) const;
+    // Overloads for views and C strings, which are checked without allocating
+    bool possiblyContains(std::string_view item) const;
+    bool possiblyContains(const char* item) const;
+    // Same with "hash" already computed as hash128(item), for callers that hashed the item for their own
+    // use; the Seeded scheme does not use it
+    bool possiblyContains(std::string_view item, const Hash128& hash) const;
 
     // Definitive check for an item's presence combining Bloom filter and CDNServer
     bool certainlyContains(const std::string& item) const;
     // Overload for r-value strings
     bool certainlyContains(std::string&& item) const;
+    // Overloads for views and C strings, which are checked without allocating
+    bool certainlyContains(std::string_view item) const;
+    bool certainlyContains(const char* item) const;
+
+    // Non-blocking certainlyContains: a negative filter answer is returned as a ready future, otherwise
+    // the backend's checkWordAsync decides
+    std::future<bool> certainlyContainsAsync(std::string_view item) const;
+    // Batch version of certainlyContains: element i of the result answers items[i]. The batch is first
+    // filtered with possiblyContainsBatch, then the backend checks of all candidates are issued before
+    // the first one is awaited, so a slow remote backend costs about one round trip per batch
+    std::vector<bool> certainlyContainsBatch(std::span<const std::string_view> items) const;
+
+    // Store consulted by the definitive checks, null for a moved-from filter
+    const std::shared_ptr<LookupBackend>& backend() const { return server; }
 
     // Reset the Bloom filter, clearing all set bits
     void reset();
 
-    // Operator overloads for combining Bloom filters
-    BloomFilter& operator&(const BloomFilter& other); // Intersection of two filters
-    BloomFilter& operator|(const BloomFilter& other); // Union of two filters
+    // Operator overloads for combining Bloom filters; the result shares the backend of the left operand
+    BloomFilter operator&(const BloomFilter& other) const; // Intersection of two filters
+    BloomFilter operator|(const BloomFilter& other) const; // Union of two filters
+    // In-place intersection and union
+    BloomFilter& operator&=(const BloomFilter& other);
+    BloomFilter& operator|=(const BloomFilter& other);
+    // Unions every filter of "filters" into this one in a single pass: the bits are walked in tiles small
+    // enough to stay in L1 while each source is streamed through once, without intermediate filters.
+    // Throws like operator| before changing anything if any of them is incompatible
+    BloomFilter& merge(std::span<const BloomFilter* const> filters);
 
     // Operator to check direct access, same as possiblyContains
-    bool operator()(const std::string& item) const;
+    bool operator()(std::string_view item) const;
+
+    // Batch version of possiblyContains: element i of the result answers items[i].
+    // Hashes a whole batch up front and then tests one probe of every key at a time,
+    // gathering the bit words with AVX2 where the CPU supports it
+    std::vector<bool> possiblyContainsBatch(std::span<const std::string_view> items) const;
+
+    // Scheme used to derive the bit positions of an item
+    HashScheme hashScheme() const { return scheme; }
+
+    // Saturation statistics, e.g. to rebuild or resize a filter before its false-positive rate degrades
+    std::size_t bitCount() const;   // Number of set bits
+    double fillRatio() const;       // Fraction of the N bits that are set
+    // Estimated number of distinct items added (Swamidass-Baldi), infinite once every bit is set
+    double estimatedCount() const;
+    // False-positive rate at the current fill, fillRatio() to the power num_hashes
+    double estimatedFalsePositiveRate() const;
+    // Estimated number of distinct items in the union and in the intersection of the two sets, from the
+    // popcount of the OR-ed bits; the intersection is |A| + |B| - |A u B|, clamped at zero. A saturated
+    // filter cannot be told from one holding every item, so the intersection with it is the other
+    // filter's estimate, and infinite when both are saturated.
+    // Throw std::invalid_argument if the filters derive their bit positions differently
+    double estimatedUnionSize(const BloomFilter& other) const;
+    double estimatedIntersectionSize(const BloomFilter& other) const;
+
+    // Memory of the filter itself, its bits and seeds, in O(1); every 64-bit word of bits counts as a node.
+    // The backend is shared with other filters and reports its own
+    MemoryUsage memoryUsage() const;
+    double RAMUsage() const; // Allocated kilobytes, as in CDNServer
+
+    // Writes the bits, num_hashes, seeds and hash scheme to "file_name" in the binary format of
+    // bloom_file, throwing std::runtime_error if the file cannot be written. The server's words are not saved
+    void save(const std::string& file_name) const;
+    // Reads a filter written by save(), backed by a new, empty CDNServer. Throws std::runtime_error
+    // if the file is missing, was written for a different N or fails its checksum
+    static BloomFilter load(const std::string& file_name);
 
 private:
-    // Bit array to represent elements presence probabilistically
-    std::bitset<N> bits;
+    // CountingBloomFilter::compact() fills the bits and seeds directly
+    friend class CountingBloomFilter<N>;
+
+    static constexpr std::size_t num_words = (N + 63) / 64;
+    using Words = std::array<std::uint64_t, num_words>;
+
+    // Bit array to represent elements presence probabilistically, stored as 64-bit words
+    alignas(64) Words bits{};
 
     // Number of hash functions used in this filter
     std::size_t num_hashes;
@@ -58,14 +254,512 @@ private:
     // Seeds for the hash functions to ensure diversity
     std::vector<std::size_t> seeds;
 
-    // Pointer to a CDNServer used to definitively check items
-    CDNServer* server;
+    // Backend used to definitively check items, possibly shared with other filters
+    std::shared_ptr<LookupBackend> server;
+
+    // Scheme used to derive the bit positions of an item
+    HashScheme scheme;
 
     // Private method to hash an item using a specific seed
-    std::size_t hash(const std::string& item, std::size_t seed) const {
-        std::hash<std::string> hasher;
-        return hasher(item + std::to_string(seed));  // Concatenate the seed to the item before hashing
+    std::size_t hash(std::string_view item, std::size_t seed) const {
+        return seededHash(item, seed);  // Concatenate the seed to the item before hashing
     }
+
+    // Sets the bits of "item" and optionally registers it with the server, shared by every add overload
+    void insert(std::string_view item, bool populate_server = true);
+
+    // Sets the bits of "item" in "words", which is either "bits" or a private partial array of addAll
+    void setBits(Words& words, std::string_view item) const;
+
+    bool testBit(std::size_t pos) const { return (bits[pos / 64] >> (pos % 64)) & 1; }
+    // Whether every bit of "item" is set, possiblyContains without the statistics
+    bool testItem(std::string_view item) const;
+    // Same from "h", which is hash128(item) for the DoubleHashing scheme and ignored by the Seeded one
+    bool testItem(std::string_view item, const Hash128& h) const;
+
+    // Throws if "other" derives its bit positions differently, in which case combining the bits is meaningless
+    void checkCompatible(const BloomFilter& other) const;
 };
 
+template <std::size_t N>
+BloomFilter<N>::BloomFilter(unsigned int num_hashes, HashScheme scheme)
+    : BloomFilter(num_hashes, std::make_shared<CDNServer>(), scheme) {}
+
+template <std::size_t N>
+BloomFilter<N>::BloomFilter(unsigned int num_hashes, std::shared_ptr<LookupBackend> backend, HashScheme scheme)
+    : num_hashes(num_hashes), seeds(num_hashes), server(std::move(backend)), scheme(scheme) {
+    if (num_hashes == 0) {
+        throw std::invalid_argument("BloomFilter: num_hashes must be positive");
+    }
+    // Deterministic seeds so that independently built filters agree and can be combined
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        seeds[i] = i;
+    }
+}
+
+template <std::size_t N>
+BloomFilter<N>::BloomFilter(const BloomFilter& other) = default;
+
+template <std::size_t N>
+BloomFilter<N>::BloomFilter(BloomFilter&& other) noexcept = default;
+
+template <std::size_t N>
+BloomFilter<N>& BloomFilter<N>::operator=(const BloomFilter& other) = default;
+
+template <std::size_t N>
+BloomFilter<N>& BloomFilter<N>::operator=(BloomFilter&& other) noexcept = default;
+
+template <std::size_t N>
+BloomFilter<N>::~BloomFilter() = default;
+
+template <std::size_t N>
+void BloomFilter<N>::add(const std::string& item) {
+    insert(item);
+}
+
+template <std::size_t N>
+void BloomFilter<N>::insert(std::string_view item, bool populate_server) {
+    const lookup_stats::ScopedTimer timer(lookup_stats::Timer::BloomAdd);
+    lookup_stats::count(lookup_stats::Counter::BloomAdd);
+    setBits(bits, item);
+    if (server && populate_server) {
+        server->addWord(item);
+    }
+}
+
+template <std::size_t N>
+void BloomFilter<N>::setBits(Words& words, std::string_view item) const {
+    const auto set = [&words](std::size_t pos) { words[pos / 64] |= std::uint64_t{1} << (pos % 64); };
+    if (scheme == HashScheme::Seeded) {
+        for (std::size_t seed : seeds) {
+            set(hash(item, seed) % N);
+        }
+    } else {
+        const Hash128 h = hash128(item);
+        for (std::size_t i = 0; i < num_hashes; ++i) {
+            set(probePosition(h, i, N));
+        }
+    }
+}
+
+template <std::size_t N>
+void BloomFilter<N>::add(std::string&& file_name) {
+    const bool loaded = forEachWordInFile(file_name, [this](std::string_view word) {
+        insert(word);
+    });
+    if (!loaded) {
+        add(static_cast<const std::string&>(file_name));
+    }
+}
+
+template <std::size_t N>
+std::size_t BloomFilter<N>::addFile(const std::string& file_name, bool populate_server, unsigned int num_threads) {
+    if (num_threads > 1) {
+        // Collect the words first so they can be split across threads; views stay valid while "file" is mapped
+        MappedFile file(file_name);
+        if (!file.isOpen()) {
+            throw std::runtime_error("BloomFilter: cannot open word file \"" + file_name + "\"");
+        }
+        if (file.isMapped()) {
+            std::vector<std::string_view> words;
+            forEachWord(file.view(), [&words](std::string_view word) { words.push_back(word); });
+            addAll(words, num_threads, populate_server);
+            return words.size();
+        }
+        std::vector<std::string> words;
+        std::ifstream stream(file_name, std::ios::binary);
+        forEachWordInStream(stream, [&words](std::string_view word) { words.emplace_back(word); });
+        addAll(words, num_threads, populate_server);
+        return words.size();
+    }
+
+    std::size_t count = 0;
+    const bool loaded = forEachWordInFile(file_name, [this, populate_server, &count](std::string_view word) {
+        insert(word, populate_server);
+        ++count;
+    });
+    if (!loaded) {
+        throw std::runtime_error("BloomFilter: cannot open word file \"" + file_name + "\"");
+    }
+    return count;
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::possiblyContains(const std::string& item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::possiblyContains(std::string_view item) const {
+    const lookup_stats::ScopedTimer timer(lookup_stats::Timer::BloomPossiblyContains);
+    const bool positive = testItem(item);
+    lookup_stats::count(lookup_stats::Counter::BloomPossiblyContains);
+    if (positive) {
+        lookup_stats::count(lookup_stats::Counter::BloomPositive);
+    }
+    return positive;
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::possiblyContains(std::string_view item, const Hash128& hash) const {
+    const lookup_stats::ScopedTimer timer(lookup_stats::Timer::BloomPossiblyContains);
+    const bool positive = testItem(item, hash);
+    lookup_stats::count(lookup_stats::Counter::BloomPossiblyContains);
+    if (positive) {
+        lookup_stats::count(lookup_stats::Counter::BloomPositive);
+    }
+    return positive;
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::testItem(std::string_view item) const {
+    return testItem(item, scheme == HashScheme::Seeded ? Hash128{} : hash128(item));
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::testItem(std::string_view item, const Hash128& h) const {
+    if (scheme == HashScheme::Seeded) {
+        for (std::size_t seed : seeds) {
+            if (!testBit(hash(item, seed) % N)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        if (!testBit(probePosition(h, i, N))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::possiblyContains(std::string&& item) const {
+    return possiblyContains(static_cast<const std::string&>(item));
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::possiblyContains(const char* item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::certainlyContains(const std::string& item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::certainlyContains(std::string&& item) const {
+    return certainlyContains(static_cast<const std::string&>(item));
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::certainlyContains(std::string_view item) const {
+    const lookup_stats::ScopedTimer timer(lookup_stats::Timer::BloomCertainlyContains);
+    lookup_stats::count(lookup_stats::Counter::BloomCertainlyContains);
+    // Only items that pass the probabilistic check ever reach the server
+    if (!possiblyContains(item) || !server) {
+        return false;
+    }
+    const bool present = server->checkWord(item);
+    if (!present) {
+        lookup_stats::count(lookup_stats::Counter::BloomFalsePositive);
+    }
+    return present;
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::certainlyContains(const char* item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+std::future<bool> BloomFilter<N>::certainlyContainsAsync(std::string_view item) const {
+    if (possiblyContains(item) && server) {
+        return server->checkWordAsync(std::string(item));
+    }
+    std::promise<bool> absent;
+    absent.set_value(false);
+    return absent.get_future();
+}
+
+template <std::size_t N>
+std::vector<bool> BloomFilter<N>::certainlyContainsBatch(std::span<const std::string_view> items) const {
+    std::vector<bool> result = possiblyContainsBatch(items);
+    if (!server) {
+        result.assign(items.size(), false);
+        return result;
+    }
+    // Issue every backend check first so that their latencies overlap, then collect the answers
+    std::vector<std::pair<std::size_t, std::future<bool>>> pending;
+    for (std::size_t j = 0; j < items.size(); ++j) {
+        if (result[j]) {
+            pending.emplace_back(j, server->checkWordAsync(std::string(items[j])));
+        }
+    }
+    for (auto& [j, answer] : pending) {
+        result[j] = answer.get();
+    }
+    return result;
+}
+
+template <std::size_t N>
+void BloomFilter<N>::reset() {
+    bits.fill(0);
+}
+
+template <std::size_t N>
+BloomFilter<N> BloomFilter<N>::operator&(const BloomFilter& other) const {
+    BloomFilter result(*this);
+    result &= other;
+    return result;
+}
+
+template <std::size_t N>
+BloomFilter<N> BloomFilter<N>::operator|(const BloomFilter& other) const {
+    BloomFilter result(*this);
+    result |= other;
+    return result;
+}
+
+template <std::size_t N>
+BloomFilter<N>& BloomFilter<N>::operator&=(const BloomFilter& other) {
+    checkCompatible(other);
+    // Plain word loops over contiguous arrays, vectorized by the compiler
+    for (std::size_t w = 0; w < num_words; ++w) {
+        bits[w] &= other.bits[w];
+    }
+    return *this;
+}
+
+template <std::size_t N>
+BloomFilter<N>& BloomFilter<N>::operator|=(const BloomFilter& other) {
+    checkCompatible(other);
+    for (std::size_t w = 0; w < num_words; ++w) {
+        bits[w] |= other.bits[w];
+    }
+    return *this;
+}
+
+template <std::size_t N>
+BloomFilter<N>& BloomFilter<N>::merge(std::span<const BloomFilter* const> filters) {
+    for (const BloomFilter* filter : filters) {
+        checkCompatible(*filter);
+    }
+    constexpr std::size_t tile_words = 512;  // 4 KiB of destination bits per tile
+    for (std::size_t lo = 0; lo < num_words; lo += tile_words) {
+        const std::size_t hi = std::min(num_words, lo + tile_words);
+        for (const BloomFilter* filter : filters) {
+            const std::uint64_t* source = filter->bits.data();
+            for (std::size_t w = lo; w < hi; ++w) {
+                bits[w] |= source[w];
+            }
+        }
+    }
+    return *this;
+}
+
+template <std::size_t N>
+bool BloomFilter<N>::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+template <std::size_t N>
+std::vector<bool> BloomFilter<N>::possiblyContainsBatch(std::span<const std::string_view> items) const {
+    std::vector<bool> result(items.size());
+    if (scheme == HashScheme::Seeded) {
+        // The legacy scheme builds a string per probe anyway, so there is nothing to batch
+        for (std::size_t j = 0; j < items.size(); ++j) {
+            result[j] = possiblyContains(items[j]);
+        }
+        return result;
+    }
+
+    constexpr std::size_t batch = 32;
+    std::array<Hash128, batch> hashes;
+    std::array<std::uint64_t, batch> positions;
+    std::array<std::uint8_t, batch> alive;
+    for (std::size_t base = 0; base < items.size(); base += batch) {
+        const std::size_t count = std::min(batch, items.size() - base);
+        for (std::size_t j = 0; j < count; ++j) {
+            hashes[j] = hash128(items[base + j]);
+            alive[j] = 1;
+        }
+        // Probe-major order: the loads of one round are independent and can all be in flight together
+        for (std::size_t i = 0; i < num_hashes; ++i) {
+            for (std::size_t j = 0; j < count; ++j) {
+                positions[j] = probePosition(hashes[j], i, N);
+            }
+            bloom_filter_detail::testBits(bits.data(), positions.data(), count, alive.data());
+            std::uint8_t any = 0;
+            for (std::size_t j = 0; j < count; ++j) {
+                any |= alive[j];
+            }
+            if (!any) {
+                break;
+            }
+        }
+        for (std::size_t j = 0; j < count; ++j) {
+            result[base + j] = alive[j] != 0;
+        }
+    }
+    return result;
+}
+
+template <std::size_t N>
+template <std::ranges::random_access_range Range>
+void BloomFilter<N>::addAll(const Range& items, unsigned int num_threads, bool populate_server) {
+    constexpr std::size_t min_items_per_thread = 4096;  // Below this a thread costs more than it saves
+    const std::size_t count = std::ranges::size(items);
+    const std::size_t threads = std::clamp<std::size_t>(count / min_items_per_thread, 1, std::max(num_threads, 1u));
+    const auto first = std::ranges::begin(items);
+
+    if (threads == 1) {
+        for (auto it = first; it != std::ranges::end(items); ++it) {
+            insert(std::string_view(*it), populate_server);
+        }
+        return;
+    }
+
+    // Heap-allocated partial arrays, a large N would not fit on the worker stacks. All of them are
+    // allocated before the first thread starts, and std::jthread joins the started ones should launching
+    // a thread or filling the server throw, so an exception propagates instead of terminating
+    std::vector<std::unique_ptr<Words>> partial(threads);
+    for (auto& words : partial) {
+        words = std::make_unique<Words>();
+    }
+    std::vector<std::jthread> workers;
+    workers.reserve(threads);
+    for (std::size_t t = 0; t < threads; ++t) {
+        const std::size_t lo = count * t / threads;
+        const std::size_t hi = count * (t + 1) / threads;
+        workers.emplace_back([this, &words = *partial[t], first, lo, hi] {
+            for (std::size_t i = lo; i < hi; ++i) {
+                setBits(words, std::string_view(first[static_cast<std::ptrdiff_t>(i)]));
+            }
+        });
+    }
+    // The server is not thread-safe, so it is filled from this thread while the workers hash
+    if (server && populate_server) {
+        for (std::size_t i = 0; i < count; ++i) {
+            server->addWord(std::string_view(first[static_cast<std::ptrdiff_t>(i)]));
+        }
+    }
+    for (std::jthread& worker : workers) {
+        worker.join();
+    }
+    for (const auto& words : partial) {
+        for (std::size_t w = 0; w < num_words; ++w) {
+            bits[w] |= (*words)[w];
+        }
+    }
+}
+
+template <std::size_t N>
+MemoryUsage BloomFilter<N>::memoryUsage() const {
+    MemoryUsage usage;
+    usage.allocated_bytes = sizeof(*this) + seeds.capacity() * sizeof(std::size_t);
+    usage.live_bytes = sizeof(bits) + seeds.size() * sizeof(std::size_t);
+    usage.nodes = num_words;
+    return usage;
+}
+
+template <std::size_t N>
+double BloomFilter<N>::RAMUsage() const {
+    return static_cast<double>(memoryUsage().allocated_bytes) / 1024.0;
+}
+
+template <std::size_t N>
+void BloomFilter<N>::save(const std::string& file_name) const {
+    std::string seed_block(bloom_file::seedsBytes(num_hashes), '\0');
+    for (std::size_t i = 0; i < seeds.size(); ++i) {
+        const std::uint64_t seed = seeds[i];
+        std::memcpy(seed_block.data() + i * sizeof(seed), &seed, sizeof(seed));
+    }
+    const std::string_view word_block(reinterpret_cast<const char*>(bits.data()), bloom_file::wordsBytes(N));
+
+    bloom_file::Header header{};
+    std::memcpy(header.magic, bloom_file::magic, sizeof(header.magic));
+    header.version = bloom_file::version;
+    header.scheme = static_cast<std::uint32_t>(scheme);
+    header.num_bits = N;
+    header.num_hashes = num_hashes;
+    header.checksum = bloom_file::checksum(seed_block, word_block);
+
+    std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(seed_block.data(), static_cast<std::streamsize>(seed_block.size()));
+    file.write(word_block.data(), static_cast<std::streamsize>(word_block.size()));
+    if (!file) {
+        throw std::runtime_error("BloomFilter: cannot write \"" + file_name + "\"");
+    }
+}
+
+template <std::size_t N>
+BloomFilter<N> BloomFilter<N>::load(const std::string& file_name) {
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("BloomFilter: cannot open \"" + file_name + "\"");
+    }
+    const std::string bytes(std::istreambuf_iterator<char>(file), {});
+    const bloom_file::Header header = bloom_file::validate(bytes, N);
+
+    BloomFilter filter(static_cast<unsigned int>(header.num_hashes), static_cast<HashScheme>(header.scheme));
+    for (std::size_t i = 0; i < filter.seeds.size(); ++i) {
+        std::uint64_t seed;
+        std::memcpy(&seed, bytes.data() + sizeof(header) + i * sizeof(seed), sizeof(seed));
+        filter.seeds[i] = static_cast<std::size_t>(seed);
+    }
+    std::memcpy(filter.bits.data(), bytes.data() + sizeof(header) + bloom_file::seedsBytes(header.num_hashes),
+                bloom_file::wordsBytes(N));
+    return filter;
+}
+
+template <std::size_t N>
+std::size_t BloomFilter<N>::bitCount() const {
+    return bloom_filter_detail::countBits(bits.data(), num_words);
+}
+
+template <std::size_t N>
+double BloomFilter<N>::fillRatio() const {
+    return static_cast<double>(bitCount()) / static_cast<double>(N);
+}
+
+template <std::size_t N>
+double BloomFilter<N>::estimatedCount() const {
+    return bloom_filter_detail::estimateItems(bitCount(), N, num_hashes);
+}
+
+template <std::size_t N>
+double BloomFilter<N>::estimatedFalsePositiveRate() const {
+    return std::pow(fillRatio(), static_cast<double>(num_hashes));
+}
+
+template <std::size_t N>
+double BloomFilter<N>::estimatedUnionSize(const BloomFilter& other) const {
+    checkCompatible(other);
+    return bloom_filter_detail::estimateItems(bloom_filter_detail::countUnionBits(bits.data(), other.bits.data(), num_words),
+                                              N, num_hashes);
+}
+
+template <std::size_t N>
+double BloomFilter<N>::estimatedIntersectionSize(const BloomFilter& other) const {
+    const double mine = estimatedCount();
+    const double theirs = other.estimatedCount();
+    const double both = estimatedUnionSize(other);
+    // Saturation makes the difference below inf - inf, which would clamp a NaN to an empty intersection
+    if (std::isinf(mine) || std::isinf(theirs)) {
+        return std::min(mine, theirs);
+    }
+    return std::max(0.0, mine + theirs - both);
+}
+
+template <std::size_t N>
+void BloomFilter<N>::checkCompatible(const BloomFilter& other) const {
+    if (num_hashes != other.num_hashes || scheme != other.scheme || seeds != other.seeds) {
+        throw std::invalid_argument("BloomFilter: cannot combine filters with different hash functions");
+    }
+}
+
 #endif // BLOOM_FILTER_H
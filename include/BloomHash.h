@@ -0,0 +1,112 @@
+#ifndef BLOOM_HASH_H
+#define BLOOM_HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Strategy used by the Bloom filters to turn an item into its bit positions
+enum class HashScheme {
+    Seeded,        // Legacy scheme: std::hash over "item + seed", one allocation and one pass per probe
+    DoubleHashing  // Kirsch-Mitzenmacher: one 128-bit hash per item, probe i lands on h1 + i * h2
+};
+
+// 128-bit hash value split into the two halves used for double hashing
+struct Hash128 {
+    std::uint64_t h1;
+    std::uint64_t h2;
+};
+
+namespace bloom_hash_detail {
+
+inline std::uint64_t rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Final avalanche step of MurmurHash3
+inline std::uint64_t fmix(std::uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+inline std::uint64_t load64(const char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));  // Unaligned-safe load, compiles down to a single mov
+    return v;
+}
+
+} // namespace bloom_hash_detail
+
+// MurmurHash3_x64_128 over the bytes of "data", evaluated in a single pass without allocating
+inline Hash128 hash128(std::string_view data, std::uint64_t seed = 0) {
+    using namespace bloom_hash_detail;
+    constexpr std::uint64_t c1 = 0x87c37b91114253d5ULL;
+    constexpr std::uint64_t c2 = 0x4cf5ad432745937fULL;
+
+    const char* p = data.data();
+    const std::size_t len = data.size();
+    const std::size_t blocks = len / 16;
+
+    std::uint64_t h1 = seed;
+    std::uint64_t h2 = seed;
+
+    // Body: 16-byte blocks
+    for (std::size_t i = 0; i < blocks; ++i, p += 16) {
+        std::uint64_t k1 = load64(p);
+        std::uint64_t k2 = load64(p + 8);
+
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // Tail: remaining 0..15 bytes
+    std::uint64_t k1 = 0;
+    std::uint64_t k2 = 0;
+    const std::size_t tail = len & 15;
+    for (std::size_t i = tail; i > 8; --i) {
+        k2 ^= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i - 1])) << ((i - 9) * 8);
+    }
+    if (tail > 8) {
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    for (std::size_t i = tail < 8 ? tail : 8; i > 0; --i) {
+        k1 ^= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i - 1])) << ((i - 1) * 8);
+    }
+    if (tail > 0) {
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    // Finalization
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    return {h1, h2 | 1};  // An odd stride never collapses onto a short cycle when the table size is even
+}
+
+// Hash of the legacy HashScheme::Seeded scheme: std::hash over the item with the seed appended
+inline std::size_t seededHash(std::string_view item, std::size_t seed) {
+    std::hash<std::string> hasher;
+    return hasher(std::string(item) + std::to_string(seed));  // Concatenate the seed to the item before hashing
+}
+
+// Bit position of the i-th probe for a table of "size" bits (Kirsch-Mitzenmacher double hashing)
+inline std::size_t probePosition(const Hash128& h, std::size_t i, std::size_t size) {
+    return static_cast<std::size_t>((h.h1 + i * h.h2) % size);
+}
+
+#endif // BLOOM_HASH_H
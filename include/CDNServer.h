@@ -1,24 +1,86 @@
 #ifndef CDNSERVER_H
 #define CDNSERVER_H
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_set>
+#include <utility>
+
+#include "LookupBackend.h" // Interface the Bloom filters use for the definitive check
+#include "LookupStats.h"   // Optional operation counters
+#include "MemoryUsage.h"   // Allocation counting behind RAMUsage
 
 // CDNServer class manages a set of strings and provides functionality to check the presence of items
-class CDNServer {
+class CDNServer : public LookupBackend {
 public:
     // Constructor initializes the server with a usage count of zero
-    CDNServer() : usage_count(0) {}
+    CDNServer()
+        : heap(std::make_unique<MemoryCounter>()),
+          words(0, WordHash{}, std::equal_to<>{}, CountingAllocator<Word>(heap.get())), word_bytes(0),
+          usage_count(0) {}
+
+    // Copy constructor, the copy allocates its words through a counter of its own
+    CDNServer(const CDNServer& other) : CDNServer() {
+        words.reserve(other.words.size());
+        for (const Word& word : other.words) {
+            words.emplace(word, words.get_allocator());
+        }
+        word_bytes = other.word_bytes;
+        usage_count = other.usage_count;
+    }
+
+    // Move constructor, leaving "other" an empty server with a fresh counter
+    CDNServer(CDNServer&& other) : CDNServer() {
+        swap(other);
+    }
+
+    // Copy and move assignment through swap
+    CDNServer& operator=(CDNServer other) {
+        swap(other);
+        return *this;
+    }
+
+    // Exchanges the contents of two servers; the set's allocators travel with the counters they report to
+    void swap(CDNServer& other) noexcept {
+        using std::swap;
+        swap(heap, other.heap);
+        words.swap(other.words);
+        swap(word_bytes, other.word_bytes);
+        swap(usage_count, other.usage_count);
+    }
 
     // Adds a word to the server's internal storage
-    void addWord(const std::string& word) {
-        words.insert(word);  // Insert the word into the unordered set
+    void addWord(std::string_view word) override {
+        lookup_stats::count(lookup_stats::Counter::ServerAddWord);
+        lookup_stats::count(lookup_stats::Counter::ServerWordBytes, word.size());
+        if (words.find(word) == words.end()) {
+            // Insert the word into the unordered set, its characters allocated through the counter as well
+            words.emplace(word, words.get_allocator());
+            word_bytes += word.size();
+        }
     }
 
-    // Checks if a word exists in the server's storage and increments the usage count
-    bool checkWord(const std::string& word) {
+    // Removes a word from the server's storage, if present
+    void removeWord(std::string_view word) override {
+        const auto it = words.find(word);
+        if (it != words.end()) {
+            word_bytes -= it->size();
+            words.erase(it);
+        }
+    }
+
+    // Checks if a word exists in the server's storage and increments the usage count.
+    // The lookup is heterogeneous, so checking a slice of a larger buffer does not allocate
+    bool checkWord(std::string_view word) override {
         ++usage_count;  // Increment usage count with each check
-        return words.find(word) != words.end();  // Return true if the word is found
+        const bool found = words.find(word) != words.end();
+        lookup_stats::count(lookup_stats::Counter::ServerCheckWord);
+        if (found) {
+            lookup_stats::count(lookup_stats::Counter::ServerHit);
+        }
+        return found;  // Return true if the word is found
     }
 
     // Returns the number of times the server has been queried
@@ -26,20 +88,31 @@ public:
         return usage_count;  // Provide the total usage count
     }
 
-    // Estimates the memory usage of the server's data in kilobytes
+    // Memory of the server in kilobytes: the set's nodes and buckets and the characters of words too long
+    // for the small-string buffer, all counted as they are allocated, so the call is O(1)
     double RAMUsage() const {
-        size_t total_memory = 0;
-        for (const auto& word : words) {
-            // Calculate memory used by each string including its storage overhead
-            total_memory += sizeof(std::string) + word.capacity() * sizeof(char);
-        }
-        // Add the memory used by the unordered_set's internal structures
-        total_memory += words.bucket_count() * sizeof(void*);
-        return static_cast<double>(total_memory) / 1024.0;  // Convert bytes to kilobytes
+        return static_cast<double>(memoryUsage().allocated_bytes) / 1024.0;  // Convert bytes to kilobytes
+    }
+
+    // Same in bytes, with the characters of the words as the live part
+    MemoryUsage memoryUsage() const {
+        return MemoryUsage{sizeof(*this) + sizeof(MemoryCounter) + heap->bytes(), word_bytes, words.size()};
     }
 
 private:
-    std::unordered_set<std::string> words;  // Container to store unique words
+    // Transparent hash so that std::string_view keys can be looked up without building a std::string
+    struct WordHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view word) const {
+            return std::hash<std::string_view>{}(word);
+        }
+    };
+
+    using Word = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+    std::unique_ptr<MemoryCounter> heap;  // Bytes allocated by "words", at a stable address for its allocators
+    std::unordered_set<Word, WordHash, std::equal_to<>, CountingAllocator<Word>> words;  // Container to store unique words
+    size_t word_bytes;                      // Characters of all words
     size_t usage_count;                     // Counter for the number of queries made to the server
 };
 
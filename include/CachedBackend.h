@@ -0,0 +1,117 @@
+#ifndef CACHED_BACKEND_H
+#define CACHED_BACKEND_H
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "LookupBackend.h" // Interface decorated by the cache
+
+// Bounded LRU cache of definitive answers in front of another LookupBackend. Skewed traffic keeps
+// sending the same false-positive candidates past the filter; with this layer between a filter and its
+// server only the first check of such a key reaches the server. Both positive and negative answers are
+// cached. Words must be added and removed through the cache so that a cached answer is corrected, and
+// an answer to a check issued before such a write is returned but not cached, so the write always wins.
+// Every member may be called from several threads at once when the decorated backend allows it; the
+// cache itself is guarded by a mutex that is never held across a call to that backend.
+class CachedBackend : public LookupBackend {
+public:
+    // Caches at most "capacity" answers of "backend"; a capacity of zero disables caching
+    CachedBackend(std::shared_ptr<LookupBackend> backend, std::size_t capacity);
+
+    CachedBackend(const CachedBackend&) = delete;
+    CachedBackend& operator=(const CachedBackend&) = delete;
+
+    // Forwards to the backend and marks a cached answer for "word" as present
+    void addWord(std::string_view word) override;
+
+    // Forwards to the backend and marks a cached answer for "word" as absent
+    void removeWord(std::string_view word) override;
+
+    // Answers from the cache when possible, otherwise asks the backend and remembers its answer
+    bool checkWord(std::string_view word) override;
+
+    // Cache hits complete immediately; misses are issued to the backend at once. An answer the backend
+    // has already given is cached before returning. Answers still pending are awaited, cached and handed
+    // on in the order they were issued by a single worker thread per cache, started by the first of them,
+    // whether or not the returned future is ever awaited. Destroying the cache waits for those answers
+    std::future<bool> checkWordAsync(std::string word) override;
+
+    std::size_t hits() const;     // Checks answered from the cache
+    std::size_t misses() const;   // Checks forwarded to the backend
+    std::size_t size() const;     // Answers currently cached
+    std::size_t capacity() const { return state->max_entries; }
+
+    // Drops every cached answer and zeroes the counters
+    void clear();
+
+    // Decorated backend
+    const std::shared_ptr<LookupBackend>& backend() const { return inner; }
+
+private:
+    struct Entry {
+        std::string word;
+        bool present;
+    };
+
+    // Asynchronous check whose answer the backend has not given yet
+    struct Pending {
+        std::string word;
+        std::uint64_t generation;  // Of the word when the check was issued
+        std::future<bool> answer;  // From the backend
+        std::promise<bool> result; // Behind the future handed to the caller
+    };
+
+    // Cached answers, counters and pending checks, shared with the worker. Every member but max_entries
+    // is guarded by "mutex"
+    struct State {
+        explicit State(std::size_t capacity) : max_entries(capacity) { index.reserve(capacity); }
+
+        // Cached answer for "word" moved to the front, or nullptr
+        const Entry* lookup(std::string_view word);
+
+        // Writes of words sharing a stripe with "word" through addWord and removeWord
+        std::uint64_t& generation(std::string_view word);
+
+        // Caches "present" for "word", evicting the least recently used answer if full, unless the word
+        // has been written since the check that gave "present" was issued at generation "issued"
+        void remember(std::string_view word, bool present, std::uint64_t issued);
+
+        // Body of the worker: caches and hands on the pending answers in order until "stop" is requested
+        // and none is left
+        void awaitPending(std::stop_token stop);
+
+        std::mutex mutex;
+        const std::size_t max_entries;
+
+        static constexpr std::size_t stripes = 64;
+        std::array<std::uint64_t, stripes> generations{};
+        std::deque<Pending> pending;         // Oldest first
+        std::condition_variable_any arrived; // Signalled when "pending" grows
+
+        std::list<Entry> entries;  // Most recently used first
+        // Keys view the words stored in "entries", whose nodes never move
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+
+        std::size_t hit_count = 0;
+        std::size_t miss_count = 0;
+    };
+
+    std::shared_ptr<LookupBackend> inner;
+    std::shared_ptr<State> state;
+    std::once_flag worker_started;
+    std::jthread worker; // Last, so that it is stopped and joined before the rest goes
+};
+
+#endif // CACHED_BACKEND_H
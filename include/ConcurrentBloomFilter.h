@@ -0,0 +1,165 @@
+#ifndef CONCURRENT_BLOOM_FILTER_H
+#define CONCURRENT_BLOOM_FILTER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "BloomHash.h" // 128-bit hashing shared with BloomFilter
+#include "WordFile.h"  // Parsing of ", "-separated word files
+
+// Bloom filter that many threads can insert into and query at the same time without a lock.
+// Bits are stored in std::atomic<std::uint64_t> words: add() sets them with a relaxed fetch_or and
+// possiblyContains() reads them with relaxed loads. A query racing with the add() of the same item
+// may still answer false; once the add() happens-before a query (same thread, a join, a queue hand-off...)
+// the item is always found, because bits are only ever set.
+// Unlike BloomFilter it owns no CDNServer: the server is not thread-safe, and registering every word
+// with it under a lock would serialize the inserts this class exists to parallelize.
+template <std::size_t N = 81920>  // Default size of the Bloom filter bit array set to 81920 bits (10 kilobytes)
+class ConcurrentBloomFilter {
+public:
+    // Constructor initializing the number of hash functions
+    ConcurrentBloomFilter(unsigned int num_hashes);
+
+    // Copy constructor, taking a snapshot of the bits of "other" while it may still be written to
+    ConcurrentBloomFilter(const ConcurrentBloomFilter& other);
+    ConcurrentBloomFilter& operator=(const ConcurrentBloomFilter&) = delete;
+
+    // Add an item to the filter, safe to call from any number of threads
+    void add(const std::string& item);
+    // Overload for adding items from a file, where words are assumed to be separated by ", "
+    // If no such file can be opened the argument itself is added as an item
+    void add(std::string&& file_name="../Resource/Word_DataSet_1.txt");
+
+    // Check if an item might be in the filter, safe to call concurrently with add()
+    bool possiblyContains(std::string_view item) const;
+    bool possiblyContains(const std::string& item) const;
+    bool possiblyContains(const char* item) const;
+
+    // Reset the filter, clearing all set bits; items added concurrently may or may not survive
+    void reset();
+
+    // Union with another filter into a new one, a snapshot of both
+    ConcurrentBloomFilter operator|(const ConcurrentBloomFilter& other) const;
+    // In-place union, word by word with fetch_or, safe to call concurrently with add()
+    ConcurrentBloomFilter& operator|=(const ConcurrentBloomFilter& other);
+
+    // Operator to check direct access, same as possiblyContains
+    bool operator()(std::string_view item) const;
+
+private:
+    static constexpr std::size_t num_words = (N + 63) / 64;
+
+    // Bit array to represent elements presence probabilistically
+    std::array<std::atomic<std::uint64_t>, num_words> bits;
+
+    // Number of hash functions used in this filter
+    std::size_t num_hashes;
+
+    // Sets the bits of "item", shared by every add overload
+    void insert(std::string_view item);
+};
+
+template <std::size_t N>
+ConcurrentBloomFilter<N>::ConcurrentBloomFilter(unsigned int num_hashes)
+    : num_hashes(num_hashes) {
+    if (num_hashes == 0) {
+        throw std::invalid_argument("ConcurrentBloomFilter: num_hashes must be positive");
+    }
+    for (auto& word : bits) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+template <std::size_t N>
+ConcurrentBloomFilter<N>::ConcurrentBloomFilter(const ConcurrentBloomFilter& other)
+    : num_hashes(other.num_hashes) {
+    for (std::size_t w = 0; w < num_words; ++w) {
+        bits[w].store(other.bits[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+template <std::size_t N>
+void ConcurrentBloomFilter<N>::add(const std::string& item) {
+    insert(item);
+}
+
+template <std::size_t N>
+void ConcurrentBloomFilter<N>::insert(std::string_view item) {
+    const Hash128 h = hash128(item);
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        const std::size_t pos = probePosition(h, i, N);
+        const std::uint64_t mask = std::uint64_t{1} << (pos % 64);
+        // Skip the read-modify-write when the bit is already set, which keeps hot lines shared
+        if (!(bits[pos / 64].load(std::memory_order_relaxed) & mask)) {
+            bits[pos / 64].fetch_or(mask, std::memory_order_relaxed);
+        }
+    }
+}
+
+template <std::size_t N>
+void ConcurrentBloomFilter<N>::add(std::string&& file_name) {
+    const bool loaded = forEachWordInFile(file_name, [this](std::string_view word) {
+        insert(word);
+    });
+    if (!loaded) {
+        add(static_cast<const std::string&>(file_name));
+    }
+}
+
+template <std::size_t N>
+bool ConcurrentBloomFilter<N>::possiblyContains(std::string_view item) const {
+    const Hash128 h = hash128(item);
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        const std::size_t pos = probePosition(h, i, N);
+        if (!((bits[pos / 64].load(std::memory_order_relaxed) >> (pos % 64)) & 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <std::size_t N>
+bool ConcurrentBloomFilter<N>::possiblyContains(const std::string& item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool ConcurrentBloomFilter<N>::possiblyContains(const char* item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+void ConcurrentBloomFilter<N>::reset() {
+    for (auto& word : bits) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+template <std::size_t N>
+ConcurrentBloomFilter<N> ConcurrentBloomFilter<N>::operator|(const ConcurrentBloomFilter& other) const {
+    ConcurrentBloomFilter result(*this);
+    result |= other;
+    return result;
+}
+
+template <std::size_t N>
+ConcurrentBloomFilter<N>& ConcurrentBloomFilter<N>::operator|=(const ConcurrentBloomFilter& other) {
+    if (num_hashes != other.num_hashes) {
+        throw std::invalid_argument("ConcurrentBloomFilter: cannot combine filters with different hash functions");
+    }
+    for (std::size_t w = 0; w < num_words; ++w) {
+        bits[w].fetch_or(other.bits[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+template <std::size_t N>
+bool ConcurrentBloomFilter<N>::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+#endif // CONCURRENT_BLOOM_FILTER_H
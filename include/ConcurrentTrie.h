@@ -0,0 +1,110 @@
+#ifndef CONCURRENT_TRIE_H
+#define CONCURRENT_TRIE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Trie;
+
+// Trie that any number of threads can search while others insert and remove, with no lock on the
+// read side. Nodes are immutable once published: a writer copies the nodes on the path it changes
+// and stores the new root atomically, so a reader sees either the old or the new version in full.
+// Nodes replaced by a write are retired rather than freed. Readers pin the current epoch for the
+// duration of a lookup, and a batch of retired nodes is freed only once every reader pinned in the
+// epoch it was retired in has left. Writers are serialized by a mutex and never wait for readers.
+class ConcurrentTrie {
+public:
+    ConcurrentTrie();
+    ConcurrentTrie(std::initializer_list<std::string> list);
+    explicit ConcurrentTrie(const Trie& trie); // Same words as "trie"
+
+    // No reader or writer may still be using the trie
+    ~ConcurrentTrie();
+
+    ConcurrentTrie(const ConcurrentTrie&) = delete;
+    ConcurrentTrie& operator=(const ConcurrentTrie&) = delete;
+
+    // Lock-free lookups, safe to call concurrently with everything but destruction. A lookup racing with
+    // a write of the same word may see the trie before or after it
+    bool search(std::string_view query) const;
+    bool startsWith(std::string_view prefix) const;
+    bool operator()(std::string_view query) const; // Same as search
+
+    // Writes, safe to call from any thread; they take the writer mutex but never wait for readers
+    void insert(std::string_view str);
+    void remove(std::string_view str); // Prunes the nodes that no longer lead to any word
+
+    // Blocks until every node retired so far has been freed, which needs current readers to finish
+    void synchronize();
+    // Nodes retired by writes and not freed yet
+    std::size_t retiredCount() const;
+
+private:
+    struct Node;
+    struct Edge {
+        unsigned char key;
+        Node* child;
+    };
+    // Never modified once reachable from a published root
+    struct Node {
+        std::vector<Edge> edges; // Sorted by key
+        bool is_finished = false;
+    };
+
+    // Reader counts for the two parities of the epoch, striped over cache lines so that readers on
+    // different threads rarely touch the same one
+    static constexpr std::size_t num_stripes = 16;
+    struct alignas(64) Counter {
+        std::atomic<std::int64_t> value{0};
+    };
+    using Counters = std::array<Counter, num_stripes>;
+
+    // Pins the epoch for a lookup: counted in the stripe of the calling thread for the parity of an epoch
+    // that was still current after the increment, so a later flip of the epoch waits for this reader
+    class ReaderPin {
+    public:
+        explicit ReaderPin(const ConcurrentTrie& trie);
+        ~ReaderPin();
+        ReaderPin(const ReaderPin&) = delete;
+        ReaderPin& operator=(const ReaderPin&) = delete;
+
+    private:
+        std::atomic<std::int64_t>* counter;
+    };
+
+    // Position of the edge for "c" in the edges of "node", or of where it would go
+    static std::size_t edgeSlot(const Node* node, unsigned char c);
+    // Child of "node" for byte "c", or nullptr
+    static const Node* child(const Node* node, unsigned char c);
+    // Adds "str" to the unpublished subtree of "node" in place, for construction
+    static void insertInPlace(Node* node, std::string_view str);
+    // Node whose path from the root of the current version spells "str", or nullptr; caller holds a pin
+    const Node* find(std::string_view str) const;
+
+    // Copy of "node" whose edge for "c" leads to "to", dropping the edge if "to" is nullptr
+    static Node* copyWith(const Node* node, unsigned char c, Node* to);
+    // Publishes "next" as the root and retires the nodes of the old version it no longer uses
+    void publish(const Node* next, const std::vector<const Node*>& replaced);
+    // Frees the waiting batch if its readers are gone, then starts a grace period for the pending one
+    void tryReclaim();
+    bool drained(std::size_t parity) const; // No reader is pinned for "parity" of the epoch
+    static void destroy(const Node* node); // Frees "node" and everything below it
+
+    std::atomic<const Node*> root;
+    std::atomic<std::uint64_t> epoch;
+    mutable std::array<Counters, 2> readers;
+
+    mutable std::mutex writer; // Serializes writers and guards the batches below
+    std::vector<const Node*> pending; // Retired since the last flip of the epoch
+    std::vector<const Node*> waiting; // Retired before the last flip, freed once its parity drains
+    std::size_t waiting_parity;
+};
+
+#endif // CONCURRENT_TRIE_H
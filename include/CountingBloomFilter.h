@@ -0,0 +1,269 @@
+#ifndef COUNTING_BLOOM_FILTER_H
+#define COUNTING_BLOOM_FILTER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "BloomFilter.h"   // Plain filter produced by compact()
+#include "BloomHash.h"     // Hashing shared with BloomFilter
+#include "CDNServer.h"     // Default backend for checking definitively if an item is in the dataset
+#include "LookupBackend.h"
+#include "WordFile.h"      // Parsing of ", "-separated word files
+
+// Counting Bloom filter: every position holds a 4-bit counter instead of a bit, sixteen counters
+// packed per 64-bit word, so items can be removed again. Positions are derived exactly as in
+// BloomFilter<N> with the same number of hashes and scheme, which lets compact() hand read-mostly
+// replicas a plain filter at a quarter of the memory.
+// A counter that reaches 15 sticks there: it can no longer tell how many items share it, so removals
+// leave it set rather than risk a false negative.
+template <std::size_t N = 81920>  // Number of counters, the N of the compacted BloomFilter
+class CountingBloomFilter {
+public:
+    static constexpr std::uint64_t max_count = 15;  // Saturation value of a 4-bit counter
+
+    // Constructor initializing the number of hash functions and the scheme used to derive positions,
+    // backed by a CDNServer of its own
+    CountingBloomFilter(unsigned int num_hashes, HashScheme scheme = HashScheme::DoubleHashing);
+    // Same, but backed by "backend", which may be shared with other filters or be null for none
+    CountingBloomFilter(unsigned int num_hashes, std::shared_ptr<LookupBackend> backend,
+                        HashScheme scheme = HashScheme::DoubleHashing);
+
+    // Add an item to the filter
+    void add(const std::string& item);
+    // Overload for adding items from a file, where words are assumed to be separated by ", "
+    // If no such file can be opened the argument itself is added as an item
+    void add(std::string&& file_name="../Resource/Word_DataSet_1.txt");
+
+    // Removes one earlier add() of "item". Returns false, changing nothing, if the item is not even
+    // possibly present. Removing an item that was never added can cause false negatives for others.
+    // The item is removed from the backend as well, so certainlyContains turns false even when its
+    // counters stay up, shared with other items or saturated. The backend holds each word once, so an
+    // item added several times is forgotten there by its first removal
+    bool remove(std::string_view item);
+    bool remove(const std::string& item);
+    bool remove(const char* item);
+
+    // Check if an item might be in the filter
+    bool possiblyContains(std::string_view item) const;
+    bool possiblyContains(const std::string& item) const;
+    bool possiblyContains(const char* item) const;
+
+    // Definitive check for an item's presence combining the filter and its backend
+    bool certainlyContains(std::string_view item) const;
+    bool certainlyContains(const std::string& item) const;
+    bool certainlyContains(const char* item) const;
+
+    // Upper bound on how many times "item" was added, the smallest of its counters
+    std::uint64_t count(std::string_view item) const;
+
+    // Reset the filter, clearing all counters
+    void reset();
+
+    // Operator to check direct access, same as possiblyContains
+    bool operator()(std::string_view item) const;
+
+    // Plain filter with a bit set wherever a counter is non-zero, answering every possiblyContains
+    // exactly as this filter and sharing its backend
+    BloomFilter<N> compact() const;
+
+    HashScheme hashScheme() const { return scheme; }
+
+    // Store consulted by the definitive checks
+    const std::shared_ptr<LookupBackend>& backend() const { return server; }
+
+private:
+    static constexpr std::size_t counters_per_word = 16;
+    static constexpr std::size_t num_words = (N + counters_per_word - 1) / counters_per_word;
+
+    // 4-bit counters, counter i in bits 4 * (i % 16) of word i / 16
+    std::array<std::uint64_t, num_words> counters{};
+
+    // Number of hash functions used in this filter
+    std::size_t num_hashes;
+
+    // Seeds of the HashScheme::Seeded scheme, the same as BloomFilter's
+    std::vector<std::size_t> seeds;
+
+    // Backend used to definitively check items, possibly shared with other filters
+    std::shared_ptr<LookupBackend> server;
+
+    // Scheme used to derive the positions of an item
+    HashScheme scheme;
+
+    std::uint64_t counter(std::size_t pos) const {
+        return (counters[pos / counters_per_word] >> (4 * (pos % counters_per_word))) & 0xF;
+    }
+
+    void setCounter(std::size_t pos, std::uint64_t value) {
+        const unsigned shift = 4 * (pos % counters_per_word);
+        std::uint64_t& word = counters[pos / counters_per_word];
+        word = (word & ~(std::uint64_t{0xF} << shift)) | (value << shift);
+    }
+
+    // Calls "func" with each of the num_hashes positions of "item"
+    template <typename Func>
+    void forEachPosition(std::string_view item, Func&& func) const;
+
+    // Increments the counters of "item" and registers it with the server, shared by every add overload
+    void insert(std::string_view item);
+};
+
+template <std::size_t N>
+CountingBloomFilter<N>::CountingBloomFilter(unsigned int num_hashes, HashScheme scheme)
+    : CountingBloomFilter(num_hashes, std::make_shared<CDNServer>(), scheme) {}
+
+template <std::size_t N>
+CountingBloomFilter<N>::CountingBloomFilter(unsigned int num_hashes, std::shared_ptr<LookupBackend> backend,
+                                            HashScheme scheme)
+    : num_hashes(num_hashes), seeds(num_hashes), server(std::move(backend)), scheme(scheme) {
+    if (num_hashes == 0) {
+        throw std::invalid_argument("CountingBloomFilter: num_hashes must be positive");
+    }
+    // Same deterministic seeds as BloomFilter, so that compact() reproduces its positions
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        seeds[i] = i;
+    }
+}
+
+template <std::size_t N>
+template <typename Func>
+void CountingBloomFilter<N>::forEachPosition(std::string_view item, Func&& func) const {
+    if (scheme == HashScheme::Seeded) {
+        for (std::size_t seed : seeds) {
+            func(seededHash(item, seed) % N);
+        }
+        return;
+    }
+    const Hash128 h = hash128(item);
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        func(probePosition(h, i, N));
+    }
+}
+
+template <std::size_t N>
+void CountingBloomFilter<N>::add(const std::string& item) {
+    insert(item);
+}
+
+template <std::size_t N>
+void CountingBloomFilter<N>::insert(std::string_view item) {
+    forEachPosition(item, [this](std::size_t pos) {
+        const std::uint64_t value = counter(pos);
+        if (value < max_count) {
+            setCounter(pos, value + 1);
+        }
+    });
+    if (server) {
+        server->addWord(item);
+    }
+}
+
+template <std::size_t N>
+void CountingBloomFilter<N>::add(std::string&& file_name) {
+    const bool loaded = forEachWordInFile(file_name, [this](std::string_view word) {
+        insert(word);
+    });
+    if (!loaded) {
+        add(static_cast<const std::string&>(file_name));
+    }
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::remove(std::string_view item) {
+    if (!possiblyContains(item)) {
+        return false;
+    }
+    // Two probes of one item may share a counter, which then drops once per probe as it rose in insert()
+    forEachPosition(item, [this](std::size_t pos) {
+        const std::uint64_t value = counter(pos);
+        if (value > 0 && value < max_count) {
+            setCounter(pos, value - 1);
+        }
+    });
+    if (server) {
+        server->removeWord(item);
+    }
+    return true;
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::remove(const std::string& item) {
+    return remove(std::string_view(item));
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::remove(const char* item) {
+    return remove(std::string_view(item));
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::possiblyContains(std::string_view item) const {
+    return count(item) > 0;
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::possiblyContains(const std::string& item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::possiblyContains(const char* item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::certainlyContains(std::string_view item) const {
+    // Only items that pass the probabilistic check ever reach the server
+    return possiblyContains(item) && server && server->checkWord(item);
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::certainlyContains(const std::string& item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::certainlyContains(const char* item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+std::uint64_t CountingBloomFilter<N>::count(std::string_view item) const {
+    std::uint64_t smallest = max_count;
+    forEachPosition(item, [this, &smallest](std::size_t pos) {
+        smallest = std::min(smallest, counter(pos));
+    });
+    return smallest;
+}
+
+template <std::size_t N>
+void CountingBloomFilter<N>::reset() {
+    counters.fill(0);
+}
+
+template <std::size_t N>
+bool CountingBloomFilter<N>::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+template <std::size_t N>
+BloomFilter<N> CountingBloomFilter<N>::compact() const {
+    BloomFilter<N> filter(static_cast<unsigned int>(num_hashes), server, scheme);
+    filter.seeds = seeds;
+    filter.bits.fill(0);
+    for (std::size_t pos = 0; pos < N; ++pos) {
+        if (counter(pos)) {
+            filter.bits[pos / 64] |= std::uint64_t{1} << (pos % 64);
+        }
+    }
+    return filter;
+}
+
+#endif // COUNTING_BLOOM_FILTER_H
@@ -0,0 +1,212 @@
+#ifndef DYNAMIC_BLOOM_FILTER_H
+#define DYNAMIC_BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BloomHash.h" // 128-bit hashing shared with BloomFilter
+#include "CDNServer.h" // Default backend for checking definitively if an item is in the dataset
+#include "LookupBackend.h"
+
+// Runtime-sized bit array stored on the heap, aligned to and padded to whole cache lines
+class BitArray {
+public:
+    static constexpr std::size_t cache_line_words = 8;  // 64 bytes
+
+    explicit BitArray(std::size_t num_bits = 0);
+    BitArray(const BitArray& other);
+    BitArray(BitArray&& other) noexcept;
+    BitArray& operator=(const BitArray& other);
+    BitArray& operator=(BitArray&& other) noexcept;
+
+    void set(std::size_t pos) { words[pos / 64] |= std::uint64_t{1} << (pos % 64); }
+    bool test(std::size_t pos) const { return (words[pos / 64] >> (pos % 64)) & 1; }
+    void clear(); // Clears every bit
+
+    std::size_t size() const { return num_bits; }         // Number of addressable bits
+    std::size_t wordCount() const { return num_words; }   // Number of allocated 64-bit words
+    std::uint64_t* data() { return words.get(); }
+    const std::uint64_t* data() const { return words.get(); }
+
+private:
+    struct AlignedDelete {
+        void operator()(std::uint64_t* p) const { ::operator delete[](p, std::align_val_t{64}); }
+    };
+
+    std::size_t num_bits;
+    std::size_t num_words;
+    std::unique_ptr<std::uint64_t[], AlignedDelete> words;
+};
+
+// Bloom filter whose size is chosen at runtime, either directly or from an expected item count and a
+// target false-positive rate. The bits live on the heap, so moves are O(1) and the object stays small.
+class DynamicBloomFilter {
+public:
+    // Constructor picking the optimal number of bits and hash functions for "expected_items"
+    // insertions at a false-positive rate of at most "false_positive_rate". The definitive checks go to
+    // "backend", a CDNServer of its own unless one is given, which may be shared or null for none
+    DynamicBloomFilter(std::size_t expected_items, double false_positive_rate,
+                       std::shared_ptr<LookupBackend> backend = std::make_shared<CDNServer>());
+
+    // Filter with exactly "num_hashes" hash functions over at least "num_bits" bits
+    static DynamicBloomFilter withDimensions(std::size_t num_bits, std::size_t num_hashes,
+                                             std::shared_ptr<LookupBackend> backend = std::make_shared<CDNServer>());
+
+    // Copy and move constructors, a copy shares the backend of "other". A moved-from filter is empty
+    // and unbacked; adding to it again gives it a single cache line of bits
+    DynamicBloomFilter(const DynamicBloomFilter& other);
+    DynamicBloomFilter(DynamicBloomFilter&& other) noexcept;
+
+    // Assignment operators, sharing or taking over the backend of "other"
+    DynamicBloomFilter& operator=(const DynamicBloomFilter& other);
+    DynamicBloomFilter& operator=(DynamicBloomFilter&& other) noexcept;
+
+    // Destructor
+    ~DynamicBloomFilter();
+
+    // Add an item to the filter
+    void add(const std::string& item);
+    // Overload for adding items from a file, where words are assumed to be separated by ", "
+    // If no such file can be opened the argument itself is added as an item
+    void add(std::string&& file_name="../Resource/Word_DataSet_1.txt");
+
+    // Check if an item might be in the filter
+    bool possiblyContains(std::string_view item) const;
+    bool possiblyContains(const std::string& item) const;
+    bool possiblyContains(const char* item) const;
+
+    // Definitive check for an item's presence combining the filter and CDNServer
+    bool certainlyContains(std::string_view item) const;
+    bool certainlyContains(const std::string& item) const;
+    bool certainlyContains(const char* item) const;
+
+    // Reset the filter, clearing all set bits
+    void reset();
+
+    // Operator overloads for combining filters of identical dimensions; the result shares the backend
+    // of the left operand
+    DynamicBloomFilter operator&(const DynamicBloomFilter& other) const; // Intersection of two filters
+    DynamicBloomFilter operator|(const DynamicBloomFilter& other) const; // Union of two filters
+    // In-place intersection and union
+    DynamicBloomFilter& operator&=(const DynamicBloomFilter& other);
+    DynamicBloomFilter& operator|=(const DynamicBloomFilter& other);
+
+    // Operator to check direct access, same as possiblyContains
+    bool operator()(std::string_view item) const;
+
+    std::size_t numBits() const { return bits.size(); }
+    std::size_t numHashes() const { return num_hashes; }
+
+    // Store consulted by the definitive checks, null for a moved-from filter
+    const std::shared_ptr<LookupBackend>& backend() const { return server; }
+
+    // Optimal filter dimensions for "n" items at false-positive rate "p"
+    static std::size_t optimalNumBits(std::size_t n, double p);
+    static std::size_t optimalNumHashes(std::size_t num_bits, std::size_t n);
+
+private:
+    struct Dimensions {
+        std::size_t num_bits;
+        std::size_t num_hashes;
+    };
+
+    // Optimal dimensions for "n" items at false-positive rate "p", the bit count computed once for both
+    static Dimensions optimalDimensions(std::size_t n, double p);
+
+    DynamicBloomFilter(Dimensions dimensions, std::shared_ptr<LookupBackend> backend);
+
+    // Sets the bits of "item" and registers it with the server, shared by every add overload
+    void insert(std::string_view item);
+
+    // Bit array to represent elements presence probabilistically
+    BitArray bits;
+
+    // Number of hash functions used in this filter
+    std::size_t num_hashes;
+
+    // Backend used to definitively check items, possibly shared with other filters
+    std::shared_ptr<LookupBackend> server;
+};
+
+// Scalable Bloom filter (Almeida et al.): when the current sub-filter reaches its planned capacity a
+// new, larger and tighter one is chained behind it, so the compound false-positive rate stays below
+// the target however far the set grows past its initial estimate.
+class ScalableBloomFilter {
+public:
+    static constexpr std::size_t growth_factor = 2;   // Capacity multiplier of each new sub-filter
+    static constexpr double tightening_ratio = 0.5;   // False-positive rate multiplier of each new sub-filter
+
+    // Constructor planning the first sub-filter for "initial_capacity" items; the false-positive rate
+    // of the whole chain never exceeds "false_positive_rate". The definitive checks go to "backend",
+    // a CDNServer of its own unless one is given, which may be shared or null for none
+    ScalableBloomFilter(std::size_t initial_capacity, double false_positive_rate,
+                        std::shared_ptr<LookupBackend> backend = std::make_shared<CDNServer>());
+
+    // Copy and move constructors, a copy shares the backend of "other"
+    ScalableBloomFilter(const ScalableBloomFilter& other);
+    ScalableBloomFilter(ScalableBloomFilter&& other) noexcept;
+
+    // Assignment operators, sharing or taking over the backend of "other"
+    ScalableBloomFilter& operator=(const ScalableBloomFilter& other);
+    ScalableBloomFilter& operator=(ScalableBloomFilter&& other) noexcept;
+
+    // Destructor
+    ~ScalableBloomFilter();
+
+    // Add an item, chaining a new sub-filter first if the current one is full
+    void add(const std::string& item);
+    // Overload for adding items from a file, where words are assumed to be separated by ", "
+    // If no such file can be opened the argument itself is added as an item
+    void add(std::string&& file_name="../Resource/Word_DataSet_1.txt");
+
+    // Check if an item might be in any sub-filter
+    bool possiblyContains(std::string_view item) const;
+    bool possiblyContains(const std::string& item) const;
+    bool possiblyContains(const char* item) const;
+
+    // Definitive check for an item's presence combining the filter and CDNServer
+    bool certainlyContains(std::string_view item) const;
+    bool certainlyContains(const std::string& item) const;
+    bool certainlyContains(const char* item) const;
+
+    // Reset the filter back to a single empty sub-filter
+    void reset();
+
+    // Operator to check direct access, same as possiblyContains
+    bool operator()(std::string_view item) const;
+
+    std::size_t stageCount() const { return stages.size(); }  // Number of chained sub-filters
+    std::size_t size() const;                                 // Number of distinct items added
+    std::size_t numBits() const;                              // Total bits over all sub-filters
+
+    // Store consulted by the definitive checks, null for a moved-from filter
+    const std::shared_ptr<LookupBackend>& backend() const { return server; }
+
+private:
+    // One sub-filter of the chain
+    struct Stage {
+        BitArray bits;
+        std::size_t num_hashes;
+        std::size_t capacity;  // Items the stage was dimensioned for
+        std::size_t count;     // Items inserted so far
+    };
+
+    void addStage();
+
+    // Adds "item" to the newest stage unless it is already present, shared by every add overload
+    void insert(std::string_view item);
+
+    std::vector<Stage> stages;
+    std::size_t initial_capacity;
+    double false_positive_rate;
+
+    // Backend used to definitively check items, possibly shared with other filters
+    std::shared_ptr<LookupBackend> server;
+};
+
+#endif // DYNAMIC_BLOOM_FILTER_H
@@ -0,0 +1,91 @@
+#ifndef FROZEN_TRIE_H
+#define FROZEN_TRIE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MemoryUsage.h"
+#include "WordFile.h" // MappedFile
+
+// On-disk format of a FrozenTrie, usable in place from a memory mapping: a 64-byte Header followed by
+// the slots of the double array. Integers are stored in native byte order.
+namespace frozen_trie_file {
+
+constexpr char magic[8] = {'F', 'R', 'O', 'Z', 'T', 'R', 'I', 'E'};
+constexpr std::uint32_t version = 1;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;     // Format version, bumped on any layout change
+    std::uint32_t reserved0;
+    std::uint64_t num_slots;   // Slots of the double array, the root being slot 0
+    std::uint64_t num_words;   // Words stored, for information only
+    std::uint64_t checksum;    // hash128 of the slot bytes
+    std::uint64_t reserved[3];
+};
+static_assert(sizeof(Header) == 64, "frozen_trie_file::Header must fill exactly one cache line");
+
+} // namespace frozen_trie_file
+
+// Immutable trie packed into one contiguous, pointer-free double array, produced by Trie::freeze() or
+// mapped from a file written by save(). State s has a child for byte c exactly when slot
+// t = base(s) + c exists and check(t) == s, so every character of a lookup costs one add and one
+// compare on an 8-byte slot, with no search among siblings. Being flat, the array can be written to disk
+// as is and served straight from the page cache by a restarted replica.
+class FrozenTrie {
+public:
+    // Maps "file_name" and validates it; the checksum pass reads the whole file and can be skipped when
+    // the file is trusted. Falls back to reading the file where mmap is unavailable.
+    // Throws std::runtime_error if the file is missing or malformed
+    explicit FrozenTrie(const std::string& file_name, bool verify_checksum = true);
+
+    FrozenTrie(const FrozenTrie&) = delete;
+    FrozenTrie& operator=(const FrozenTrie&) = delete;
+    FrozenTrie(FrozenTrie&& other) noexcept = default;
+    FrozenTrie& operator=(FrozenTrie&& other) noexcept = default;
+
+    // Same answers as the Trie that was frozen
+    bool search(std::string_view query) const;
+    bool startsWith(std::string_view prefix) const;
+    bool operator()(std::string_view query) const; // Same as search
+
+    // Writes the double array to "file_name" in the format of frozen_trie_file, throwing
+    // std::runtime_error if the file cannot be written
+    void save(const std::string& file_name) const;
+
+    std::size_t size() const { return num_words; }          // Words stored
+    std::size_t slotCount() const { return num_slots; }     // Slots of the double array, 8 bytes each
+
+    // The slots are the live part and every slot counts as a node. A mapped file counts as allocated, as
+    // it occupies the page cache instead of the heap
+    MemoryUsage memoryUsage() const;
+
+private:
+    friend class Trie; // Trie::freeze() packs the array
+
+    struct Slot {
+        std::uint32_t base;  // Children of this state are at base + byte; top bit set if a word ends here
+        std::uint32_t check; // State whose child this slot is, "vacant" if the slot is unused
+    };
+    static_assert(sizeof(Slot) == 8, "FrozenTrie::Slot must stay 8 bytes, it is the file format");
+
+    static constexpr std::uint32_t vacant = UINT32_MAX;
+    static constexpr std::uint32_t terminal = std::uint32_t{1} << 31;
+
+    FrozenTrie(std::vector<Slot> slots, std::size_t num_words);
+
+    // State reached by following "str" from the root, or "vacant"
+    std::uint32_t find(std::string_view str) const;
+
+    std::vector<Slot> owned;           // Slots built in memory or read without mmap
+    std::unique_ptr<MappedFile> file;  // Mapping the slots point into, if any
+    const Slot* slots;
+    std::size_t num_slots;
+    std::size_t num_words;
+};
+
+#endif // FROZEN_TRIE_H
@@ -0,0 +1,37 @@
+#ifndef LOOKUP_BACKEND_H
+#define LOOKUP_BACKEND_H
+
+#include <future>
+#include <string>
+#include <string_view>
+
+// Authoritative store behind the Bloom filters, consulted by certainlyContains once an item passes the
+// probabilistic check. Filters hold their backend through a std::shared_ptr, so several filters can
+// share one store; CDNServer is the in-process implementation.
+class LookupBackend {
+public:
+    virtual ~LookupBackend() = default;
+
+    // Registers a word with the store
+    virtual void addWord(std::string_view word) = 0;
+
+    // Forgets a word, called by filters that support removal. The default keeps it: a store that cannot
+    // forget words goes on confirming a removed word whenever the filter still lets it through
+    virtual void removeWord(std::string_view word) {
+        static_cast<void>(word);
+    }
+
+    // Blocking definitive check for a word
+    virtual bool checkWord(std::string_view word) = 0;
+
+    // Non-blocking definitive check. A remote backend overrides this to put the request on the wire and
+    // return immediately, so a caller can keep many checks in flight and wait for them together.
+    // The default answers synchronously and hands back an already satisfied future
+    virtual std::future<bool> checkWordAsync(std::string word) {
+        std::promise<bool> result;
+        result.set_value(checkWord(word));
+        return result.get_future();
+    }
+};
+
+#endif // LOOKUP_BACKEND_H
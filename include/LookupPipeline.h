@@ -0,0 +1,127 @@
+#ifndef LOOKUP_PIPELINE_H
+#define LOOKUP_PIPELINE_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "LookupBackend.h" // Remote tier of words()
+
+// Chain of lookup stages tried in order until one of them decides, each cheaper and less certain than
+// the next. The stock chains are words(), where a Bloom filter screens the query, a local dictionary
+// answers what it holds and only its misses go to the LookupBackend, and prefixes(), the same for
+// startsWith with a filter of every prefix. Further stages can be appended with then(). Every stage
+// counts what it decided and the time spent in it. The counters are not atomic, so a pipeline is used
+// from one thread at a time. Stages hold references to the filter and dictionary they were built from,
+// which must outlive the pipeline.
+class LookupPipeline {
+public:
+    enum class Verdict {
+        Absent,   // The query is certainly not in the set
+        Present,  // The query is certainly in the set
+        Undecided // Left to the next stage
+    };
+    using Check = std::function<Verdict(std::string_view)>;
+
+    struct StageStats {
+        std::string name;
+        std::size_t present = 0;           // Queries answered "present" here
+        std::size_t absent = 0;            // Queries answered "absent" here
+        std::size_t passed = 0;            // Queries handed on to the next stage
+        std::chrono::nanoseconds time{0};  // Total time spent in the stage
+
+        std::size_t hits() const { return present + absent; } // Queries decided here
+        std::size_t misses() const { return passed; }
+        std::size_t calls() const { return present + absent + passed; }
+    };
+
+    // A pipeline with no stage answers "absent" to everything
+    LookupPipeline() = default;
+
+    // Appends a stage named "name" and returns the pipeline, for chaining
+    LookupPipeline& then(std::string name, Check check);
+
+    // Runs the stages on "query" until one decides; "absent" if none does
+    bool contains(std::string_view query);
+    bool operator()(std::string_view query); // Same as contains
+
+    // Counters of every stage, in pipeline order
+    const std::vector<StageStats>& stats() const { return stage_stats; }
+    void resetStats();
+
+    // Filter "filter" -> dictionary.search -> backend->checkWord, the backend stage omitted when null.
+    // "filter" may be any filter with possiblyContains(std::string_view) and "dictionary" anything with
+    // search(std::string_view), a Trie, FrozenTrie, RadixTrie or ConcurrentTrie
+    template <typename Filter, typename Dictionary>
+    static LookupPipeline words(const Filter& filter, const Dictionary& dictionary,
+                                std::shared_ptr<LookupBackend> backend);
+
+    // Filter "prefix_filter" -> dictionary.startsWith -> "remote" for the prefixes the dictionary misses.
+    // The filter must hold every prefix of every word, see addPrefixes(). Without "remote" the dictionary
+    // answer is final, as no LookupBackend can check prefixes
+    template <typename Filter, typename Dictionary>
+    static LookupPipeline prefixes(const Filter& prefix_filter, const Dictionary& dictionary,
+                                   std::function<bool(std::string_view)> remote = {});
+
+    // Adds every prefix of "word" to "filter", the empty one and "word" itself included
+    template <typename Filter>
+    static void addPrefixes(Filter& filter, std::string_view word);
+
+private:
+    std::vector<Check> checks;
+    std::vector<StageStats> stage_stats; // stage_stats[i] counts checks[i]
+};
+
+template <typename Filter, typename Dictionary>
+LookupPipeline LookupPipeline::words(const Filter& filter, const Dictionary& dictionary,
+                                     std::shared_ptr<LookupBackend> backend) {
+    LookupPipeline pipeline;
+    pipeline.then("filter", [&filter](std::string_view word) {
+        return filter.possiblyContains(word) ? Verdict::Undecided : Verdict::Absent;
+    });
+    pipeline.then("dictionary", [&dictionary](std::string_view word) {
+        return dictionary.search(word) ? Verdict::Present : Verdict::Undecided;
+    });
+    if (backend) {
+        pipeline.then("backend", [backend = std::move(backend)](std::string_view word) {
+            return backend->checkWord(word) ? Verdict::Present : Verdict::Absent;
+        });
+    }
+    return pipeline;
+}
+
+template <typename Filter, typename Dictionary>
+LookupPipeline LookupPipeline::prefixes(const Filter& prefix_filter, const Dictionary& dictionary,
+                                        std::function<bool(std::string_view)> remote) {
+    LookupPipeline pipeline;
+    pipeline.then("prefix filter", [&prefix_filter](std::string_view prefix) {
+        return prefix_filter.possiblyContains(prefix) ? Verdict::Undecided : Verdict::Absent;
+    });
+    const Verdict miss = remote ? Verdict::Undecided : Verdict::Absent;
+    pipeline.then("dictionary", [&dictionary, miss](std::string_view prefix) {
+        return dictionary.startsWith(prefix) ? Verdict::Present : miss;
+    });
+    if (remote) {
+        pipeline.then("remote", [remote = std::move(remote)](std::string_view prefix) {
+            return remote(prefix) ? Verdict::Present : Verdict::Absent;
+        });
+    }
+    return pipeline;
+}
+
+template <typename Filter>
+void LookupPipeline::addPrefixes(Filter& filter, std::string_view word) {
+    // An lvalue, so that BloomFilter::add takes the item overload rather than the file name one
+    std::string prefix;
+    for (std::size_t length = 0; length <= word.size(); ++length) {
+        prefix.assign(word.substr(0, length));
+        filter.add(prefix);
+    }
+}
+
+#endif // LOOKUP_PIPELINE_H
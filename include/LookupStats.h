@@ -0,0 +1,149 @@
+#ifndef LOOKUP_STATS_H
+#define LOOKUP_STATS_H
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Process-wide operation counters and latency histograms for BloomFilter, Trie and CDNServer, compiled
+// in only when LOOKUP_STATS is defined to 1 (cmake -DLOOKUP_STATS=ON). Otherwise count() and ScopedTimer
+// are empty inline code and the hot paths are unchanged. Every thread records into a block of its own,
+// aligned to a cache line and written without read-modify-write instructions, so recording never
+// causes contention or false sharing. snapshot() sums the blocks of all threads, exited ones included.
+namespace lookup_stats {
+
+#if defined(LOOKUP_STATS) && LOOKUP_STATS
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class Counter : std::size_t {
+    BloomAdd,                // Items added to a BloomFilter
+    BloomPossiblyContains,   // possiblyContains calls, those made by certainlyContains included
+    BloomPositive,           // possiblyContains calls that answered true
+    BloomCertainlyContains,  // certainlyContains calls
+    BloomFalsePositive,      // certainlyContains calls that passed the filter but not the backend
+    TrieInsert,
+    TrieRemove,
+    TrieSearch,
+    TrieStartsWith,
+    TrieNodesCreated,        // Nodes allocated by inserts, unions and loads
+    TrieNodesPruned,         // Nodes released by remove and difference
+    ServerAddWord,
+    ServerWordBytes,         // Bytes of the words given to addWord
+    ServerCheckWord,
+    ServerHit,               // checkWord calls that found the word
+    count
+};
+
+enum class Timer : std::size_t {
+    BloomAdd,
+    BloomPossiblyContains,
+    BloomCertainlyContains,
+    TrieSearch,
+    TrieStartsWith,
+    count
+};
+
+inline constexpr std::size_t num_counters = static_cast<std::size_t>(Counter::count);
+inline constexpr std::size_t num_timers = static_cast<std::size_t>(Timer::count);
+
+// Latency distribution in nanoseconds with HDR-style log-linear buckets: exact below 16 ns, then 16
+// buckets per power of two, so any recorded value is known to within 1/16 of itself. Durations from
+// 2^40 ns (about 18 minutes) up fall into the last bucket
+struct Histogram {
+    static constexpr std::size_t sub_buckets = 16;
+    static constexpr std::size_t max_bits = 40;
+    static constexpr std::size_t num_buckets = (max_bits - 3) * sub_buckets;
+
+    static constexpr std::size_t bucketOf(std::uint64_t ns) {
+        if (ns < sub_buckets) {
+            return static_cast<std::size_t>(ns);
+        }
+        const auto width = static_cast<std::size_t>(std::bit_width(ns));
+        if (width > max_bits) {
+            return num_buckets - 1;
+        }
+        const std::size_t shift = width - 5; // Keeps the top 5 bits, the leading one and 4 sub-bucket bits
+        return (shift + 1) * sub_buckets + static_cast<std::size_t>(ns >> shift) - sub_buckets;
+    }
+    // Smallest value that falls into "bucket"
+    static constexpr std::uint64_t lowestOf(std::size_t bucket) {
+        if (bucket < sub_buckets) {
+            return bucket;
+        }
+        const std::size_t shift = bucket / sub_buckets - 1;
+        return static_cast<std::uint64_t>(sub_buckets + bucket % sub_buckets) << shift;
+    }
+
+    std::uint64_t count() const;
+    // Value at or above a "fraction" (0 to 1) of the recorded values, as the upper end of its bucket; 0 if
+    // nothing was recorded
+    std::uint64_t percentile(double fraction) const;
+
+    std::array<std::uint64_t, num_buckets> counts{};
+};
+
+struct Snapshot {
+    std::uint64_t operator[](Counter counter) const { return counters[static_cast<std::size_t>(counter)]; }
+    const Histogram& operator[](Timer timer) const { return latencies[static_cast<std::size_t>(timer)]; }
+
+    std::array<std::uint64_t, num_counters> counters{};
+    std::array<Histogram, num_timers> latencies{};
+};
+
+// Totals over every thread so far; all zeros when the layer is compiled out. Recording goes on
+// meanwhile, so counters read together may be a few operations apart
+Snapshot snapshot();
+// Zeroes every counter and histogram. Operations recorded concurrently with the reset may be lost
+void reset();
+
+#if defined(LOOKUP_STATS) && LOOKUP_STATS
+
+namespace detail {
+
+// Adds "amount" to a cell only the calling thread writes, so a plain load and store is enough
+void bump(Counter counter, std::uint64_t amount);
+void record(Timer timer, std::uint64_t ns);
+
+} // namespace detail
+
+inline void count(Counter counter, std::uint64_t amount = 1) {
+    detail::bump(counter, amount);
+}
+
+// Records the lifetime of the object into the histogram of a Timer
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        detail::record(timer, static_cast<std::uint64_t>(std::chrono::nanoseconds(elapsed).count()));
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Timer timer;
+    std::chrono::steady_clock::time_point start;
+};
+
+#else
+
+inline void count(Counter, std::uint64_t = 1) {}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer) {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#endif
+
+} // namespace lookup_stats
+
+#endif // LOOKUP_STATS_H
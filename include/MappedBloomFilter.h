@@ -0,0 +1,98 @@
+#ifndef MAPPED_BLOOM_FILTER_H
+#define MAPPED_BLOOM_FILTER_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "BloomFilter.h" // Binary file format written by BloomFilter::save
+#include "WordFile.h"    // MappedFile
+
+// Read-only Bloom filter answering possiblyContains straight from a memory-mapped file written by
+// BloomFilter<N>::save. Nothing is copied or parsed beyond the header, so a restarted node can serve
+// queries as soon as the file is mapped; pages are faulted in lazily as probes touch them.
+template <std::size_t N = 81920>  // Must match the N of the filter that wrote the file
+class MappedBloomFilter {
+public:
+    // Maps "file_name" and validates it; the checksum pass reads the whole file and can be skipped
+    // when the file is trusted. Throws std::runtime_error on any mismatch or if mmap is unavailable
+    explicit MappedBloomFilter(const std::string& file_name, bool verify_checksum = true);
+
+    MappedBloomFilter(const MappedBloomFilter&) = delete;
+    MappedBloomFilter& operator=(const MappedBloomFilter&) = delete;
+
+    // Check if an item might be in the filter, same answers as the BloomFilter that was saved
+    bool possiblyContains(std::string_view item) const;
+    bool possiblyContains(const std::string& item) const;
+    bool possiblyContains(const char* item) const;
+
+    // Operator to check direct access, same as possiblyContains
+    bool operator()(std::string_view item) const;
+
+    std::size_t numHashes() const { return num_hashes; }
+    HashScheme hashScheme() const { return scheme; }
+
+private:
+    MappedFile file;
+    const std::uint64_t* seeds;
+    const std::uint64_t* words;
+    std::size_t num_hashes;
+    HashScheme scheme;
+
+    bool testBit(std::size_t pos) const { return (words[pos / 64] >> (pos % 64)) & 1; }
+};
+
+template <std::size_t N>
+MappedBloomFilter<N>::MappedBloomFilter(const std::string& file_name, bool verify_checksum)
+    : file(file_name), seeds(nullptr), words(nullptr), num_hashes(0), scheme(HashScheme::DoubleHashing) {
+    if (!file.isOpen()) {
+        throw std::runtime_error("MappedBloomFilter: cannot open \"" + file_name + "\"");
+    }
+    if (!file.isMapped()) {
+        throw std::runtime_error("MappedBloomFilter: memory mapping is unavailable, use BloomFilter::load");
+    }
+    const bloom_file::Header header = bloom_file::validate(file.view(), N, verify_checksum);
+    num_hashes = static_cast<std::size_t>(header.num_hashes);
+    scheme = static_cast<HashScheme>(header.scheme);
+    // The mapping is page-aligned and every section starts on a 64-byte boundary
+    const char* base = file.view().data();
+    seeds = reinterpret_cast<const std::uint64_t*>(base + sizeof(bloom_file::Header));
+    words = reinterpret_cast<const std::uint64_t*>(base + sizeof(bloom_file::Header) + bloom_file::seedsBytes(num_hashes));
+}
+
+template <std::size_t N>
+bool MappedBloomFilter<N>::possiblyContains(std::string_view item) const {
+    if (scheme == HashScheme::Seeded) {
+        for (std::size_t i = 0; i < num_hashes; ++i) {
+            if (!testBit(seededHash(item, static_cast<std::size_t>(seeds[i])) % N)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const Hash128 h = hash128(item);
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        if (!testBit(probePosition(h, i, N))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <std::size_t N>
+bool MappedBloomFilter<N>::possiblyContains(const std::string& item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool MappedBloomFilter<N>::possiblyContains(const char* item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+template <std::size_t N>
+bool MappedBloomFilter<N>::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+#endif // MAPPED_BLOOM_FILTER_H
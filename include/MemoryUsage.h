@@ -0,0 +1,76 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Memory held by one data structure, kept up to date as it changes so that reporting it is O(1). The
+// byte counts are those requested from the allocator; malloc adds its own few bytes per block on top.
+struct MemoryUsage {
+    std::size_t allocated_bytes = 0; // The object itself and everything it allocated, free capacity included
+    std::size_t live_bytes = 0;      // Of those, the bytes holding live elements
+    std::size_t nodes = 0;           // Live elements: trie nodes, words or filter bit words
+
+    // Allocated bytes per live element, and how many of them are not element payload
+    double bytesPerNode() const {
+        return nodes ? static_cast<double>(allocated_bytes) / static_cast<double>(nodes) : 0.0;
+    }
+    double overheadPerNode() const {
+        return nodes ? static_cast<double>(allocated_bytes - live_bytes) / static_cast<double>(nodes) : 0.0;
+    }
+};
+
+// Running total of the bytes allocated through the CountingAllocators that share it. Not atomic, the
+// containers using it are not shared between threads either
+class MemoryCounter {
+public:
+    void allocated(std::size_t bytes) { total += bytes; }
+    void released(std::size_t bytes) { total -= bytes; }
+    std::size_t bytes() const { return total; }
+
+private:
+    std::size_t total = 0;
+};
+
+// std::allocator that reports every allocation to a MemoryCounter, so node-based containers such as
+// std::unordered_set account for their nodes and buckets exactly. A default-constructed allocator
+// counts nothing
+template <typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+    // A container swapped or move-assigned takes the allocator, and so the counter, of its source
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    CountingAllocator() noexcept = default;
+    explicit CountingAllocator(MemoryCounter* counter) noexcept : counter(counter) {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept : counter(other.counter) {}
+
+    T* allocate(std::size_t n) {
+        T* memory = std::allocator<T>().allocate(n);
+        if (counter) {
+            counter->allocated(n * sizeof(T));
+        }
+        return memory;
+    }
+    void deallocate(T* memory, std::size_t n) noexcept {
+        if (counter) {
+            counter->released(n * sizeof(T));
+        }
+        std::allocator<T>().deallocate(memory, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& other) const noexcept { return counter == other.counter; }
+
+private:
+    template <typename U>
+    friend class CountingAllocator;
+
+    MemoryCounter* counter = nullptr;
+};
+
+#endif // MEMORY_USAGE_H
@@ -0,0 +1,77 @@
+#ifndef RADIX_TRIE_H
+#define RADIX_TRIE_H
+
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compressed radix (Patricia) trie with the interface of Trie. Every chain of single-child nodes is
+// merged into one edge label, so a long word that shares no prefix costs one node instead of one per
+// character, and a node only stores the children it actually has. Labels are arbitrary bytes, so unlike
+// Trie any character can be stored.
+class RadixTrie {
+public:
+    class Node {
+    public:
+        explicit Node(std::string label = "", bool is_finished = false);
+
+        Node* parent; // Pointer to the parent node, parent of the root is "nullptr"
+        std::string label; // Characters on the edge from the parent to this node, empty for the root
+        std::vector<std::unique_ptr<Node>> children; // Sorted by first label character, which is unique
+        std::string first_bytes; // first_bytes[i] is the first label character of children[i], scanned on lookup
+        bool is_finished;
+    };
+
+    // Constructors
+    RadixTrie();
+    RadixTrie(const RadixTrie& other);
+    RadixTrie(RadixTrie&& other) noexcept;
+    RadixTrie(std::initializer_list<std::string> list);
+
+    // Destructor
+    ~RadixTrie();
+
+    // Assignment operators
+    RadixTrie& operator=(const RadixTrie& other);
+    RadixTrie& operator=(RadixTrie&& other) noexcept;
+
+    // Basic operations, same meaning as in Trie
+    void insert(std::string_view str);
+    bool search(std::string_view query) const;
+    bool startsWith(std::string_view prefix) const;
+    void remove(std::string_view str); // Removes a word and re-merges the chains it leaves behind
+
+    // Traversal over the compressed nodes, same order as in Trie
+    void bfs(std::function<void(Node*&)> func);
+    void dfs(std::function<void(Node*&)> func);
+
+    // I/O operators, same ", "-separated format as Trie
+    friend std::ostream& operator<<(std::ostream& os, const RadixTrie& trie);
+    friend std::istream& operator>>(std::istream& is, RadixTrie& trie);
+
+    // Additional operators, same meaning as in Trie
+    RadixTrie operator+(const RadixTrie& other) const;
+    RadixTrie& operator+=(const RadixTrie& other);
+    RadixTrie operator-(const RadixTrie& other) const;
+    RadixTrie& operator-=(const RadixTrie& other);
+    bool operator()(std::string_view query) const;
+    bool operator==(const RadixTrie& other) const;
+    bool operator!=(const RadixTrie& other) const;
+
+private:
+    std::unique_ptr<Node> root; // Null for a moved-from trie, which behaves as an empty one
+
+    // Child of "node" whose label starts with "c", or nullptr
+    static Node* child(const Node* node, char c);
+
+    // Node whose path spells exactly "str", or nullptr
+    Node* find(std::string_view str) const;
+
+    std::vector<std::string> allWords() const;
+};
+
+#endif // RADIX_TRIE_H
@@ -0,0 +1,116 @@
+#ifndef SHARDED_BLOOM_FILTER_H
+#define SHARDED_BLOOM_FILTER_H
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "BloomFilter.h"      // One filter per shard
+#include "BloomHash.h"
+#include "LookupStats.h"      // Optional operation counters and latency histograms
+#include "MemoryUsage.h"
+#include "ShardedCDNServer.h" // Backend whose shards the filters mirror
+
+// Bloom filter split into one BloomFilter<N> per shard of a ShardedCDNServer: filter s holds exactly
+// the items of server shard s, chosen by ShardedCDNServer::shardOf. A query picks its shard from the item's
+// hash and touches that shard's filter and, past it, that shard's table only, so neither the bits
+// of other shards nor their locks are involved. The filters hold no backend of their own.
+// Queries are const and may run from any number of threads; add() must not run concurrently with
+// anything else on the filter, as with BloomFilter.
+template <std::size_t N = 81920>  // Bits per shard
+class ShardedBloomFilter {
+public:
+    // One filter with "num_hashes" hash functions per shard of "backend", which must not be null
+    ShardedBloomFilter(unsigned int num_hashes,
+                       std::shared_ptr<ShardedCDNServer> backend = std::make_shared<ShardedCDNServer>());
+
+    // Adds an item to the filter of its shard and registers it with the server
+    void add(std::string_view item);
+
+    // Check if an item might be in the filter of its shard
+    bool possiblyContains(std::string_view item) const;
+    bool operator()(std::string_view item) const; // Same as possiblyContains
+
+    // Definitive check: the filter of the item's shard, then for positives the same shard of the server
+    bool certainlyContains(std::string_view item) const;
+
+    std::size_t shardCount() const { return filters.size(); }
+    // Filter of shard "s", holding the items ShardedCDNServer::shardOf maps to "s"
+    const BloomFilter<N>& shard(std::size_t s) const { return filters.at(s); }
+
+    // Store consulted by the definitive checks
+    const std::shared_ptr<ShardedCDNServer>& backend() const { return server; }
+
+    // Memory of the filters, not of the shared server, which reports its own
+    MemoryUsage memoryUsage() const;
+
+private:
+    std::vector<BloomFilter<N>> filters; // filters[s] mirrors shard s of "server"
+    std::shared_ptr<ShardedCDNServer> server;
+};
+
+template <std::size_t N>
+ShardedBloomFilter<N>::ShardedBloomFilter(unsigned int num_hashes, std::shared_ptr<ShardedCDNServer> backend)
+    : server(std::move(backend)) {
+    if (!server) {
+        throw std::invalid_argument("ShardedBloomFilter: backend must not be null");
+    }
+    filters.reserve(server->shardCount());
+    for (std::size_t s = 0; s < server->shardCount(); ++s) {
+        filters.emplace_back(num_hashes, nullptr);
+    }
+}
+
+template <std::size_t N>
+void ShardedBloomFilter<N>::add(std::string_view item) {
+    // An lvalue string, so that BloomFilter::add takes the item overload rather than the file name one
+    const std::string word(item);
+    filters[server->shardOf(item)].add(word);
+    server->addWord(item);
+}
+
+template <std::size_t N>
+bool ShardedBloomFilter<N>::possiblyContains(std::string_view item) const {
+    // The hash that picks the shard also gives the filter its bit positions
+    const Hash128 hash = hash128(item);
+    return filters[server->shardOf(hash)].possiblyContains(item, hash);
+}
+
+template <std::size_t N>
+bool ShardedBloomFilter<N>::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+template <std::size_t N>
+bool ShardedBloomFilter<N>::certainlyContains(std::string_view item) const {
+    const lookup_stats::ScopedTimer timer(lookup_stats::Timer::BloomCertainlyContains);
+    lookup_stats::count(lookup_stats::Counter::BloomCertainlyContains);
+    // Hashed once: the same hash picks the shard, the filter's bit positions and the server's slot
+    const Hash128 hash = hash128(item);
+    if (!filters[server->shardOf(hash)].possiblyContains(item, hash)) {
+        return false;
+    }
+    const bool present = server->checkWord(item, hash);
+    if (!present) {
+        lookup_stats::count(lookup_stats::Counter::BloomFalsePositive);
+    }
+    return present;
+}
+
+template <std::size_t N>
+MemoryUsage ShardedBloomFilter<N>::memoryUsage() const {
+    MemoryUsage usage{sizeof(*this) + (filters.capacity() - filters.size()) * sizeof(BloomFilter<N>), 0, 0};
+    for (const BloomFilter<N>& filter : filters) {
+        const MemoryUsage part = filter.memoryUsage();
+        usage.allocated_bytes += part.allocated_bytes;
+        usage.live_bytes += part.live_bytes;
+        usage.nodes += part.nodes;
+    }
+    return usage;
+}
+
+#endif // SHARDED_BLOOM_FILTER_H
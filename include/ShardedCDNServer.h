@@ -0,0 +1,82 @@
+#ifndef SHARDED_CDN_SERVER_H
+#define SHARDED_CDN_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "BloomHash.h"     // hash128, which picks both the shard and the slot of a word
+#include "LookupBackend.h" // Interface the Bloom filters use for the definitive check
+#include "MemoryUsage.h"
+
+// CDNServer for many threads at once. Words are spread over a power-of-two number of shards by the top
+// bits of hash128(word).h1, and every shard is an open-addressing table in the style of a Swiss table:
+// one control byte per slot holding a 7-bit tag of the hash or "empty", scanned 16 at a time, next to
+// flat 8-byte slots that locate the word's characters in the shard's arena, a single std::string holding
+// every word of the shard back to back. A lookup reads one group of control bytes, usually one slot and
+// one run of characters, and allocates nothing.
+// checkWord takes the shard's lock shared and addWord exclusively, so checks proceed in parallel except
+// with an addWord to the same shard. The usage count is a relaxed atomic per shard. Words are never
+// removed, removeWord being the default that keeps them, so the tables need no tombstones.
+class ShardedCDNServer : public LookupBackend {
+public:
+    static constexpr std::size_t default_shards = 16;
+
+    // Server with "num_shards" shards, rounded up to a power of two. Throws std::invalid_argument for zero
+    explicit ShardedCDNServer(std::size_t num_shards = default_shards);
+    ~ShardedCDNServer() override;
+
+    ShardedCDNServer(const ShardedCDNServer&) = delete;
+    ShardedCDNServer& operator=(const ShardedCDNServer&) = delete;
+
+    // Adds a word to its shard, safe to call concurrently with every other member
+    void addWord(std::string_view word) override;
+    // Checks if a word exists and increments the usage count, safe to call from any number of threads
+    bool checkWord(std::string_view word) override;
+    // Same with "hash" already computed as hash128(word), for callers that hashed the word to pick a shard
+    bool checkWord(std::string_view word, const Hash128& hash);
+
+    // Shard that holds or would hold "word", from the word or its hash128. ShardedBloomFilter keeps one
+    // filter per shard indexed the same way
+    std::size_t shardOf(std::string_view word) const { return shardOf(hash128(word)); }
+    std::size_t shardOf(const Hash128& hash) const {
+        return shard_bits ? static_cast<std::size_t>(hash.h1 >> (64 - shard_bits)) : 0;
+    }
+    std::size_t shardCount() const { return std::size_t{1} << shard_bits; }
+
+    // Number of distinct words over all shards
+    std::size_t size() const;
+
+    // Returns the number of times the server has been queried
+    std::size_t getUsageCount() const;
+
+    // Memory of the server in kilobytes, as in CDNServer
+    double RAMUsage() const;
+    // Same in bytes: control bytes, slots and arenas at their capacity, with the words' characters as the
+    // live part. O(number of shards)
+    MemoryUsage memoryUsage() const;
+
+private:
+    // Position of a word in its shard's arena
+    struct Slot {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct Shard;
+
+    // Slot of "word" in "shard", or npos; the caller holds the shard's lock
+    static std::size_t find(const Shard& shard, std::string_view word, const Hash128& hash);
+    // Slot the probe sequence of "hash" reaches first that is empty; the table must have one
+    static std::size_t firstEmpty(const Shard& shard, const Hash128& hash);
+    // Doubles the number of slots of "shard" and re-inserts its words
+    static void grow(Shard& shard);
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::size_t shard_bits;
+    std::unique_ptr<Shard[]> shards;
+};
+
+#endif // SHARDED_CDN_SERVER_H
@@ -1,31 +1,144 @@
 #ifndef TRIE_H
 #define TRIE_H
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <ranges>
 #include <string>
+#include <string_view>
 #include <initializer_list>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "FrozenTrie.h" // Read-only form produced by freeze()
+#include "MemoryUsage.h"
+
+// Binary format written by Trie::save(): a 64-byte Header followed by one record per node in preorder,
+// children in byte order. A record is the byte of the edge into the node (0 for the root), a flags byte
+// and, when the header says so, the 4-byte weight of the word ending there. Integers are stored in native
+// byte order
+namespace trie_file {
+
+constexpr char magic[8] = {'T', 'R', 'I', 'E', 'D', 'U', 'M', 'P'};
+constexpr std::uint32_t version = 1;
+
+constexpr std::uint32_t has_weights = 1; // Header::flags: records carry a weight
+
+// Record flags
+constexpr std::uint8_t finished = 1;      // A word ends at the node
+constexpr std::uint8_t has_children = 2;  // The records of its children follow
+constexpr std::uint8_t last_child = 4;    // No sibling after its subtree
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;     // Format version, bumped on any layout change
+    std::uint32_t flags;
+    std::uint64_t num_nodes;   // Records in the body, the root first
+    std::uint64_t num_words;   // Words stored, for information only
+    std::uint64_t body_bytes;  // Bytes of records after the header
+    std::uint64_t checksum;    // hash128 of the body
+    std::uint64_t reserved[2];
+};
+static_assert(sizeof(Header) == 64, "trie_file::Header must fill exactly one cache line");
+
+} // namespace trie_file
 
 class Trie {
 public:
+    // Nodes live in the trie's node pool and refer to each other by 32-bit pool index. Up to four
+    // children are kept in the node itself, more in a separate block sized to how many there are (see
+    // Trie::Kind), so a node costs 32 bytes instead of one pointer per letter and any byte can label an edge
     class Node {
     public:
+        static constexpr std::uint32_t npos = UINT32_MAX; // Index meaning "no node"
+
         Node(char data = '\0', bool is_finished = false);
-        ~Node(); // To manage deletion of children nodes
 
-        Node* parent; // Pointer to the parent node, parent of the root is "nullptr"
-        std::array<Node*, 26> children; // Array of 26 Node pointers, covering English alphabet
+        std::uint32_t parent; // Index of the parent node, parent of the root is "npos"
+        std::array<std::uint32_t, 4> children; // Node4: child indices in key order, otherwise children[0] is the index of the block
+        std::array<unsigned char, 4> keys; // Node4: byte under which each child is stored
+        std::uint16_t child_count;
+        std::uint8_t kind; // Trie::Kind of the children block
         char data; // data for root node is "\0"
         bool is_finished;
     };
 
+    // Input iterator over the words starting with a prefix in lexicographic order, see withPrefix().
+    // It keeps a single string that grows and shrinks as it walks, so nothing is allocated per node
+    // visited. Any change to the trie invalidates it
+    class PrefixIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string*;
+        using reference = const std::string&;
+
+        PrefixIterator() = default;
+
+        reference operator*() const { return word; }
+        pointer operator->() const { return &word; }
+        PrefixIterator& operator++();
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const { return stack.empty(); }
+
+    private:
+        friend class Trie;
+
+        struct Frame {
+            std::uint32_t node;
+            std::uint32_t cursor; // Where the next child of "node" is looked for, see Trie::nextChild
+        };
+
+        PrefixIterator(const Trie& trie, std::string_view prefix, std::size_t limit);
+        void advance(); // Moves on to the next word, emptying "stack" after the last one
+
+        const Trie* trie = nullptr;
+        std::string word;
+        std::vector<Frame> stack; // Path from the prefix node down to the node of "word"
+        std::size_t remaining = 0;
+    };
+
+    // Words yielded by withPrefix(), iterable with a range-for any number of times
+    class PrefixRange {
+    public:
+        PrefixIterator begin() const { return PrefixIterator(*trie, prefix, limit); }
+        std::default_sentinel_t end() const { return {}; }
+
+    private:
+        friend class Trie;
+        PrefixRange(const Trie& trie, std::string_view prefix, std::size_t limit)
+            : trie(&trie), prefix(prefix), limit(limit) {}
+
+        const Trie* trie;
+        std::string prefix;
+        std::size_t limit;
+    };
+
     // Constructors
     Trie();
     Trie(const Trie& other);
     Trie(Trie&& other);
     Trie(std::initializer_list<std::string> list);
 
+    // Bulk construction from a random-access range of strings or string views using "num_threads"
+    // threads. The words are split by first byte into ranges of about equal total length, every thread
+    // builds the subtrees of its range in a trie of its own and the finished subtrees are attached under
+    // one root. The subtrees share no node, so no locking is needed; the input need not be sorted
+    template <std::ranges::random_access_range Range>
+    static Trie fromWords(const Range& words, unsigned int num_threads = std::thread::hardware_concurrency());
+    // Same for the words of a ", "-separated file, throwing std::runtime_error if it cannot be opened
+    static Trie fromFile(const std::string& file_name, unsigned int num_threads = std::thread::hardware_concurrency());
+
     // Destructor
     ~Trie();
 
@@ -35,29 +148,397 @@ public:
 
     // Basic Trie operations
     void insert(const std::string& str);
-    bool search(const std::string& query) const;
-    bool startsWith(const std::string& prefix) const; // Check if there is any word in the trie that starts with the given prefix
+    void insert(const std::string& str, std::uint32_t weight); // Inserts "str" or updates its weight, see topK()
+    bool search(std::string_view query) const; // Accepts std::string, string literals and slices of larger buffers without copying
+    bool startsWith(std::string_view prefix) const; // Check if there is any word in the trie that starts with the given prefix
     void remove(const std::string& str); // Remove a word from the Trie, consider removing the trace if needed.
 
+    // Autocompletion
+    // At most "limit" words starting with "prefix", in lexicographic order and produced lazily
+    PrefixRange withPrefix(std::string_view prefix, std::size_t limit = SIZE_MAX) const;
+    // The "k" heaviest words starting with "prefix", heaviest first, with their weights. Words inserted
+    // without a weight weigh 0; equal weights come out shorter words first. Every node knows the largest
+    // weight below it, so subtrees that cannot make the cut are never entered
+    std::vector<std::pair<std::string, std::uint32_t>> topK(std::string_view prefix, std::size_t k) const;
+    // Weight of "word", 0 if it is not in the trie or was inserted without one
+    std::uint32_t weight(std::string_view word) const;
+
+    // Binary dump of the nodes themselves in the format of trie_file, words and weights included. Both
+    // directions are one linear pass with no per-word string, against printing and re-inserting every
+    // word for the text operators. Writing throws std::runtime_error if the stream or file fails
+    void save(std::ostream& os) const;
+    void save(const std::string& file_name) const;
+    // Reads a dump written by save(); the checksum pass can be skipped when the input is trusted.
+    // Throws std::runtime_error if the input is missing, truncated or malformed
+    static Trie load(std::istream& is, bool verify_checksum = true);
+    static Trie load(const std::string& file_name, bool verify_checksum = true);
+
+    // Immutable, contiguous copy of this trie answering search and startsWith, for read-only replicas.
+    // Throws std::length_error if the double array would exceed 2^31 slots
+    FrozenTrie freeze() const;
+
+    // Memory of the pools, computed from their extents in O(1). The live part is the nodes and children
+    // blocks in use, the rest is free capacity of the slabs and bookkeeping
+    MemoryUsage memoryUsage() const;
+    double RAMUsage() const; // Allocated kilobytes, as in CDNServer
+
     // Traversal and Utility
     void bfs(std::function<void(Node*&)> func); // Breadth-first over the node and calling "func" function over each of them
     void dfs(std::function<void(Node*&)> func); // (BONUS), Depth-first over the node and calling "func" function over each of them
+    // Same traversals for any callable taking a Node*&, inlined instead of called through std::function.
+    // Setting the pointer to nullptr skips the children of that node
+    template <typename Func>
+    void visit_bfs(Func&& func);
+    template <typename Func>
+    void visit_dfs(Func&& func);
 
     // I/O operators
     friend std::ostream& operator<<(std::ostream& os, const Trie& trie); // Output operator
     friend std::istream& operator>>(std::istream& is, Trie& trie); // Input operator
 
     // Additional Operators
-    Trie operator+(const Trie& other) const; // Creates a new Trie containing all unique words from both operands
+    // Union and difference walk both tries side by side, node by node, without spelling out any word.
+    // The rvalue overloads build the result in the nodes of the operand that is about to die. A word in
+    // both operands of a union keeps the larger of its two weights, whatever the overload
+    Trie operator+(const Trie& other) const&; // Creates a new Trie containing all unique words from both operands
+    Trie operator+(const Trie& other) &&;
+    Trie operator+(Trie&& other) const&;
+    Trie operator+(Trie&& other) &&;
     Trie& operator+=(const Trie& other); // Adds all words from the right-hand operand into the left-hand Trie
-    Trie operator-(const Trie& other) const; // Creates a new Trie containing words from the first Trie not in the second
+    Trie operator-(const Trie& other) const&; // Creates a new Trie containing words from the first Trie not in the second
+    Trie operator-(const Trie& other) &&;
     Trie& operator-=(const Trie& other); // Removes words from the left-hand Trie found in the right-hand Trie
-    bool operator()(const std::string& query) const; // Can be used to check existence or perform other string operations
+    bool operator()(std::string_view query) const; // Can be used to check existence or perform other string operations
     bool operator==(const Trie& other) const; // Check if two Tries have exactly the same words
     bool operator!=(const Trie& other) const; // Check if two Tries differ in any word
 
 private:
-    Node* root;
+    // Arena of trivially copyable T. Slab k has first_slab << k elements, so a slab is never moved or
+    // reallocated (Node pointers handed to bfs/dfs stay valid while the trie grows), an index maps to its
+    // slab with one bit scan, and copying or destroying a trie is one pass per slab instead of a recursive
+    // new/delete per node. Freed indices are reused before the pool grows
+    template <typename T>
+    class Pool {
+    public:
+        static constexpr std::uint32_t first_slab = 32;
+
+        Pool() = default;
+        Pool(const Pool& other) : used(other.used), free_list(other.free_list) {
+            slabs.reserve(other.slabs.size());
+            for (std::size_t k = 0; k < other.slabs.size(); ++k) {
+                const std::size_t count = std::size_t{first_slab} << k;
+                slabs.push_back(std::make_unique_for_overwrite<T[]>(count));
+                std::copy_n(other.slabs[k].get(), count, slabs.back().get());
+            }
+        }
+        Pool(Pool&& other) noexcept
+            : slabs(std::move(other.slabs)), used(std::exchange(other.used, 0)), free_list(std::move(other.free_list)) {
+            other.slabs.clear();
+            other.free_list.clear();
+        }
+        Pool& operator=(Pool other) noexcept {
+            std::swap(slabs, other.slabs);
+            std::swap(used, other.used);
+            std::swap(free_list, other.free_list);
+            return *this;
+        }
+
+        T& operator[](std::uint32_t index) { return slabs[slabOf(index)][offsetOf(index)]; }
+        const T& operator[](std::uint32_t index) const { return slabs[slabOf(index)][offsetOf(index)]; }
+
+        // Index of a new element initialized to "value"
+        std::uint32_t allocate(const T& value) {
+            std::uint32_t index;
+            if (!free_list.empty()) {
+                index = free_list.back();
+                free_list.pop_back();
+            } else {
+                if (used == Node::npos) {
+                    throw std::length_error("Trie: node pool exhausted");
+                }
+                index = used++;
+                if (slabOf(index) == slabs.size()) {
+                    slabs.push_back(std::make_unique_for_overwrite<T[]>(std::size_t{first_slab} << slabs.size()));
+                }
+            }
+            (*this)[index] = value;
+            return index;
+        }
+        // Returns an element to the pool, its index may be handed out again by allocate()
+        void release(std::uint32_t index) { free_list.push_back(index); }
+
+        // Copies every element of "other", freed ones included, to the end of this pool and returns the index
+        // the first one got, so that index i of "other" is offset + i here. Elements freed in "other" stay free
+        std::uint32_t append(const Pool& other) {
+            if (std::uint64_t{used} + other.used >= Node::npos) {
+                throw std::length_error("Trie: node pool exhausted");
+            }
+            const std::uint32_t offset = used;
+            for (std::uint32_t i = 0; i < other.used; ++i) {
+                const std::uint32_t index = used++;
+                if (slabOf(index) == slabs.size()) {
+                    slabs.push_back(std::make_unique_for_overwrite<T[]>(std::size_t{first_slab} << slabs.size()));
+                }
+                (*this)[index] = other[i];
+            }
+            for (std::uint32_t freed : other.free_list) {
+                free_list.push_back(offset + freed);
+            }
+            return offset;
+        }
+
+        // Bytes of the slabs, free elements included, and of the bookkeeping around them
+        std::size_t allocatedBytes() const {
+            return ((std::size_t{first_slab} << slabs.size()) - first_slab) * sizeof(T) +
+                   slabs.capacity() * sizeof(slabs[0]) + free_list.capacity() * sizeof(std::uint32_t);
+        }
+
+        bool empty() const { return used == 0; }
+        std::size_t extent() const { return used; } // One past the highest index ever handed out
+        std::size_t size() const { return used - free_list.size(); } // Live elements
+
+    private:
+        static std::uint32_t slabOf(std::uint32_t index) {
+            return static_cast<std::uint32_t>(std::bit_width(index + first_slab)) - 1 - std::countr_zero(first_slab);
+        }
+        static std::uint32_t offsetOf(std::uint32_t index) {
+            return index + first_slab - (first_slab << slabOf(index));
+        }
+
+        std::vector<std::unique_ptr<T[]>> slabs;
+        std::uint32_t used = 0; // High-water mark of handed out indices
+        std::vector<std::uint32_t> free_list;
+    };
+
+    // Children blocks in the style of Adaptive Radix Trees, grown to the next kind when full and shrunk
+    // back with some hysteresis. Children are kept in unsigned byte order, so traversals and operator<<
+    // see the words sorted as std::string sorts them
+    enum Kind : std::uint8_t {
+        Node4,   // Up to 4 children held in the node, all of its keys compared at once
+        Node16,  // Up to 16 children, sorted keys compared all at once with SSE2 where available
+        Node48,  // Up to 48 children, a 256-entry byte map to their slots
+        Node256  // A child index for every byte value
+    };
+    struct Children16 {
+        alignas(16) std::array<unsigned char, 16> keys;
+        std::array<std::uint32_t, 16> nodes;
+    };
+    struct Children48 {
+        std::array<std::uint8_t, 256> slot; // 1 + position in "nodes" of the child for a byte, 0 if none
+        std::array<std::uint32_t, 48> nodes;
+    };
+    struct Children256 {
+        std::array<std::uint32_t, 256> nodes; // Node::npos where there is no child
+    };
+
+    static constexpr std::uint32_t root = 0; // The root is always the first node of the pool
+
+    Pool<Node> nodes; // Empty for a moved-from trie, which behaves as an empty one
+    Pool<Children16> children16;
+    Pool<Children48> children48;
+    Pool<Children256> children256;
+
+    // Word weights for topK(), indexed like "nodes". Left empty until a weight is first given, so tries
+    // used without weights pay nothing for them
+    struct Weight {
+        std::uint32_t own; // Weight of the word ending at the node
+        std::uint32_t subtree; // Largest weight of any word ending at or below the node
+    };
+    std::vector<Weight> weights;
+
+    // Child of node "index" for byte "c", or Node::npos
+    std::uint32_t child(std::uint32_t index, unsigned char c) const;
+    // Adds "child" under byte "c" of node "index", moving its children to a larger block if needed
+    void addChild(std::uint32_t index, unsigned char c, std::uint32_t child);
+    // Removes the child under byte "c" of node "index", moving the rest to a smaller block if sparse enough
+    void removeChild(std::uint32_t index, unsigned char c);
+    // Next child of "node" in byte order from position "cursor", which starts at 0 and is advanced past
+    // the child returned; Node::npos after the last one
+    std::uint32_t nextChild(const Node& node, std::uint32_t& cursor) const;
+    // Calls "func" with every child index of "node" in byte order, or in reverse byte order
+    template <typename Func>
+    void forEachChild(const Node& node, Func&& func, bool reverse = false) const;
+    // Moves the children of "node" into a new block of "kind" and releases the old block
+    void regroup(Node& node, Kind kind);
+    void releaseChildren(Node& node);
+    // Index of a new node holding "data" under "parent"
+    std::uint32_t newNode(char data, std::uint32_t parent);
+    // Largest weight at or below node "index", from its own weight and its children's Weight::subtree
+    std::uint32_t subtreeWeight(std::uint32_t index) const;
+    // Recomputes Weight::subtree from node "index" up to the root, stopping where it no longer changes
+    void updateWeights(std::uint32_t index);
+    // The word spelled by the path from the root to node "index"
+    std::string wordAt(std::uint32_t index) const;
+
+    // Index of the node reached by following "str" from the root, or Node::npos if there is no such path
+    std::uint32_t find(std::string_view str) const;
+    // Index of the node reached by following "str" from the root, creating the nodes missing on the way
+    std::uint32_t findOrCreate(std::string_view str);
+
+    // Rebuilds a trie from a whole dump, header included
+    static Trie decode(std::string_view bytes, bool verify_checksum);
+
+    // Moves the subtrees of the root of "part" under the root of this trie by splicing its pools onto the
+    // end of ours. No first byte may have a subtree in both, and neither may carry weights
+    void attach(Trie&& part);
+
+    bool hasChildren(std::uint32_t index) const { return nodes[index].child_count != 0; }
 };
 
+template <typename Func>
+void Trie::forEachChild(const Node& node, Func&& func, bool reverse) const {
+    const std::size_t count = node.child_count;
+    if (count == 0) {
+        return;
+    }
+    switch (node.kind) {
+    case Node4:
+    case Node16: {
+        const std::uint32_t* children = node.kind == Node4 ? node.children.data()
+                                                           : children16[node.children[0]].nodes.data();
+        for (std::size_t i = 0; i < count; ++i) {
+            func(children[reverse ? count - 1 - i : i]);
+        }
+        break;
+    }
+    case Node48: {
+        const Children48& block = children48[node.children[0]];
+        for (std::size_t i = 0; i < 256; ++i) {
+            const std::uint8_t slot = block.slot[reverse ? 255 - i : i];
+            if (slot) {
+                func(block.nodes[slot - 1]);
+            }
+        }
+        break;
+    }
+    default: {
+        const Children256& block = children256[node.children[0]];
+        for (std::size_t i = 0; i < 256; ++i) {
+            const std::uint32_t child = block.nodes[reverse ? 255 - i : i];
+            if (child != Node::npos) {
+                func(child);
+            }
+        }
+        break;
+    }
+    }
+}
+
+template <typename Func>
+void Trie::visit_bfs(Func&& func) {
+    if (nodes.empty()) {
+        return;
+    }
+    // One level at a time through two reused buffers, rather than a queue that allocates as it grows
+    std::vector<std::uint32_t> level;
+    std::vector<std::uint32_t> next;
+    level.reserve(64);
+    next.reserve(64);
+    level.push_back(root);
+    while (!level.empty()) {
+        for (std::uint32_t index : level) {
+            Node* node = &nodes[index];
+            func(node);
+            if (node) {
+                forEachChild(*node, [&next](std::uint32_t child) { next.push_back(child); });
+            }
+        }
+        level.swap(next);
+        next.clear();
+    }
+}
+
+template <typename Func>
+void Trie::visit_dfs(Func&& func) {
+    if (nodes.empty()) {
+        return;
+    }
+    std::vector<std::uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        Node* node = &nodes[stack.back()];
+        stack.pop_back();
+        func(node);
+        if (node) {
+            // Pushed in reverse so children are visited in byte order
+            forEachChild(*node, [&stack](std::uint32_t child) { stack.push_back(child); }, true);
+        }
+    }
+}
+
+template <std::ranges::random_access_range Range>
+Trie Trie::fromWords(const Range& words, unsigned int num_threads) {
+    constexpr std::size_t min_words_per_thread = 4096;  // Below this a thread costs more than it saves
+    const std::size_t count = std::ranges::size(words);
+    const std::size_t threads = std::clamp<std::size_t>(count / min_words_per_thread, 1, std::max(num_threads, 1u));
+    const auto first = std::ranges::begin(words);
+    const auto word = [first](std::size_t i) { return std::string_view(first[static_cast<std::ptrdiff_t>(i)]); };
+
+    Trie result;
+    if (threads == 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            result.nodes[result.findOrCreate(word(i))].is_finished = true;
+        }
+        return result;
+    }
+
+    // Cut the 256 first bytes into "threads" contiguous ranges carrying about the same number of characters
+    std::array<std::size_t, 256> load{};
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::string_view w = word(i);
+        if (w.empty()) {
+            result.nodes[root].is_finished = true;
+        } else {
+            load[static_cast<unsigned char>(w.front())] += w.size();
+            total += w.size();
+        }
+    }
+    std::vector<std::size_t> bounds{0};
+    std::size_t carried = 0;
+    for (std::size_t c = 0; c < 256; ++c) {
+        carried += load[c];
+        if (bounds.size() < threads && carried < total && carried * threads >= total * bounds.size()) {
+            bounds.push_back(c + 1);
+        }
+    }
+    bounds.push_back(256);
+
+    // Every worker scans all words but only inserts those of its range, which is cheap next to inserting.
+    // The parts and the error slots are allocated before the first thread starts, and std::jthread joins
+    // the started ones should launching a thread throw. An exception thrown by a worker, such as
+    // std::bad_alloc, is kept in its slot and rethrown here once every worker has finished
+    std::vector<Trie> parts(bounds.size() - 1);
+    std::vector<std::exception_ptr> errors(parts.size());
+    std::vector<std::jthread> workers;
+    workers.reserve(parts.size());
+    for (std::size_t t = 0; t < parts.size(); ++t) {
+        workers.emplace_back([&part = parts[t], &error = errors[t], &word, count, lo = bounds[t], hi = bounds[t + 1]] {
+            try {
+                for (std::size_t i = 0; i < count; ++i) {
+                    const std::string_view w = word(i);
+                    if (!w.empty() && static_cast<unsigned char>(w.front()) >= lo && static_cast<unsigned char>(w.front()) < hi) {
+                        part.nodes[part.findOrCreate(w)].is_finished = true;
+                    }
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+        });
+    }
+    for (std::jthread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    for (Trie& part : parts) {
+        result.attach(std::move(part));
+    }
+    return result;
+}
+
 #endif // TRIE_H
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef WORD_FILE_H
+#define WORD_FILE_H
+
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a whole file, memory-mapped where the platform supports it so that
+// multi-gigabyte word lists are tokenized straight from the page cache without being copied
+class MappedFile {
+public:
+    // Maps "file_name"; check isOpen() / isMapped() for the outcome
+    explicit MappedFile(const std::string& file_name);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return open; }       // The file exists and is readable
+    bool isMapped() const { return mapped; }   // view() covers the whole file
+    std::string_view view() const { return {data, size}; }
+
+private:
+    const char* data;
+    std::size_t size;
+    bool open;
+    bool mapped;
+};
+
+// Calls "func" with every word of "content", where words are separated by ", ".
+// Whitespace around a word (including line breaks) is not part of it and empty entries are skipped.
+// The delimiter scan goes through std::string_view::find and therefore the vectorized memchr of the
+// C library; the words passed to "func" are views into "content" and are never copied.
+template <typename Func>
+void forEachWord(std::string_view content, Func&& func) {
+    constexpr std::string_view whitespace = " \t\r\n";
+    std::size_t start = 0;
+    while (start <= content.size()) {
+        std::size_t end = content.find(',', start);
+        if (end == std::string_view::npos) {
+            end = content.size();
+        }
+        const std::size_t first = content.find_first_not_of(whitespace, start);
+        if (first != std::string_view::npos && first < end) {
+            const std::size_t last = content.find_last_not_of(whitespace, end - 1);
+            func(content.substr(first, last - first + 1));
+        }
+        start = end + 1;
+    }
+}
+
+// Streams "is" in chunks of "chunk_size" bytes and calls "func" with every word in it, so memory use
+// does not grow with the input; a word straddling two chunks is carried over to the next one
+template <typename Func>
+void forEachWordInStream(std::istream& is, Func&& func, std::size_t chunk_size = std::size_t{1} << 20) {
+    std::vector<char> buffer;
+    std::size_t carried = 0;  // Bytes of an unfinished word kept from the previous chunk
+    while (is) {
+        buffer.resize(carried + chunk_size);
+        is.read(buffer.data() + carried, static_cast<std::streamsize>(chunk_size));
+        const std::size_t filled = carried + static_cast<std::size_t>(is.gcount());
+        const std::string_view chunk(buffer.data(), filled);
+        if (!is) {
+            forEachWord(chunk, func);
+            break;
+        }
+        // Only hand over complete words; whatever follows the last separator may continue in the next chunk
+        const std::size_t cut = chunk.rfind(',');
+        if (cut == std::string_view::npos) {
+            carried = filled;
+            continue;
+        }
+        forEachWord(chunk.substr(0, cut), func);
+        carried = filled - (cut + 1);
+        std::copy(buffer.begin() + static_cast<std::ptrdiff_t>(cut + 1),
+                  buffer.begin() + static_cast<std::ptrdiff_t>(filled), buffer.begin());
+    }
+}
+
+// Reads the word file at "file_name" and calls "func" with every word in it.
+// The file is memory-mapped when possible and otherwise streamed in large chunks.
+// Returns false, without calling "func", if the file cannot be opened.
+template <typename Func>
+bool forEachWordInFile(const std::string& file_name, Func&& func) {
+    {
+        MappedFile file(file_name);
+        if (!file.isOpen()) {
+            return false;
+        }
+        if (file.isMapped()) {
+            forEachWord(file.view(), func);
+            return true;
+        }
+    }
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    forEachWordInStream(file, func);
+    return true;
+}
+
+#endif // WORD_FILE_H
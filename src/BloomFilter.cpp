@@ -1 +1,125 @@
-#include "BloomFilter.h"
\ No newline at end of file
+#include "BloomFilter.h"
+
+#include <bit>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define BLOOM_FILTER_HAVE_AVX2_KERNEL 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// BloomFilter is a class template and is implemented in its header.
+// Explicitly instantiating the default size here type-checks every member once per build.
+template class BloomFilter<>;
+
+namespace bloom_filter_detail {
+
+namespace {
+
+using TestBitsKernel = void (*)(const std::uint64_t*, const std::uint64_t*, std::size_t, std::uint8_t*);
+
+void testBitsScalar(const std::uint64_t* words, const std::uint64_t* positions, std::size_t count, std::uint8_t* alive) {
+    for (std::size_t j = 0; j < count; ++j) {
+        const std::uint64_t pos = positions[j];
+        alive[j] &= static_cast<std::uint8_t>((words[pos / 64] >> (pos % 64)) & 1);
+    }
+}
+
+#if defined(BLOOM_FILTER_HAVE_AVX2_KERNEL)
+__attribute__((target("avx2")))
+void testBitsAvx2(const std::uint64_t* words, const std::uint64_t* positions, std::size_t count, std::uint8_t* alive) {
+    const __m256i low6 = _mm256_set1_epi64x(63);
+    const __m256i one = _mm256_set1_epi64x(1);
+    std::size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        const __m256i pos = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(positions + j));
+        const __m256i index = _mm256_srli_epi64(pos, 6);
+        const __m256i gathered = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(words), index, 8);
+        const __m256i bit = _mm256_and_si256(_mm256_srlv_epi64(gathered, _mm256_and_si256(pos, low6)), one);
+        alignas(32) std::uint64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), bit);
+        for (std::size_t l = 0; l < 4; ++l) {
+            alive[j + l] &= static_cast<std::uint8_t>(lanes[l]);
+        }
+    }
+    testBitsScalar(words, positions + j, count - j, alive + j);
+}
+#elif defined(__ARM_NEON)
+// NEON has no gather, but the shift-and-mask of two lanes at a time still vectorizes
+void testBitsNeon(const std::uint64_t* words, const std::uint64_t* positions, std::size_t count, std::uint8_t* alive) {
+    std::size_t j = 0;
+    for (; j + 2 <= count; j += 2) {
+        const uint64x2_t pos = vld1q_u64(positions + j);
+        const std::uint64_t loaded[2] = {words[positions[j] / 64], words[positions[j + 1] / 64]};
+        const int64x2_t shift = vnegq_s64(vreinterpretq_s64_u64(vandq_u64(pos, vdupq_n_u64(63))));
+        const uint64x2_t bit = vandq_u64(vshlq_u64(vld1q_u64(loaded), shift), vdupq_n_u64(1));
+        alive[j] &= static_cast<std::uint8_t>(vgetq_lane_u64(bit, 0));
+        alive[j + 1] &= static_cast<std::uint8_t>(vgetq_lane_u64(bit, 1));
+    }
+    testBitsScalar(words, positions + j, count - j, alive + j);
+}
+#endif
+
+using CountBitsKernel = std::size_t (*)(const std::uint64_t*, const std::uint64_t*, std::size_t);
+
+// Counts the bits of a[w] | b[w]; countBits passes the same array twice
+std::size_t countBitsScalar(const std::uint64_t* a, const std::uint64_t* b, std::size_t count) {
+    std::size_t total = 0;
+    for (std::size_t w = 0; w < count; ++w) {
+        total += static_cast<std::size_t>(std::popcount(a[w] | b[w]));
+    }
+    return total;
+}
+
+#if defined(BLOOM_FILTER_HAVE_AVX2_KERNEL)
+// Same loop, but compiled so that the builtin lowers to one POPCNT per word
+__attribute__((target("popcnt")))
+std::size_t countBitsPopcnt(const std::uint64_t* a, const std::uint64_t* b, std::size_t count) {
+    std::size_t total = 0;
+    for (std::size_t w = 0; w < count; ++w) {
+        total += static_cast<std::size_t>(__builtin_popcountll(a[w] | b[w]));
+    }
+    return total;
+}
+#endif
+
+CountBitsKernel selectCountKernel() {
+#if defined(BLOOM_FILTER_HAVE_AVX2_KERNEL)
+    if (__builtin_cpu_supports("popcnt")) {
+        return countBitsPopcnt;
+    }
+#endif
+    return countBitsScalar;
+}
+
+TestBitsKernel selectKernel() {
+#if defined(BLOOM_FILTER_HAVE_AVX2_KERNEL)
+    if (__builtin_cpu_supports("avx2")) {
+        return testBitsAvx2;
+    }
+    return testBitsScalar;
+#elif defined(__ARM_NEON)
+    return testBitsNeon;
+#else
+    return testBitsScalar;
+#endif
+}
+
+} // namespace
+
+void testBits(const std::uint64_t* words, const std::uint64_t* positions, std::size_t count, std::uint8_t* alive) {
+    static const TestBitsKernel kernel = selectKernel();
+    kernel(words, positions, count, alive);
+}
+
+std::size_t countBits(const std::uint64_t* words, std::size_t count) {
+    return countUnionBits(words, words, count);
+}
+
+std::size_t countUnionBits(const std::uint64_t* a, const std::uint64_t* b, std::size_t count) {
+    static const CountBitsKernel kernel = selectCountKernel();
+    return kernel(a, b, count);
+}
+
+} // namespace bloom_filter_detail
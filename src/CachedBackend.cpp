@@ -0,0 +1,170 @@
+#include "CachedBackend.h"
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+CachedBackend::CachedBackend(std::shared_ptr<LookupBackend> backend, std::size_t capacity)
+    : inner(std::move(backend)), state(std::make_shared<State>(capacity)) {
+    if (!inner) {
+        throw std::invalid_argument("CachedBackend: backend must not be null");
+    }
+}
+
+void CachedBackend::addWord(std::string_view word) {
+    inner->addWord(word);
+    const std::lock_guard lock(state->mutex);
+    ++state->generation(word);
+    const auto it = state->index.find(word);
+    if (it != state->index.end()) {
+        it->second->present = true;
+    }
+}
+
+void CachedBackend::removeWord(std::string_view word) {
+    inner->removeWord(word);
+    const std::lock_guard lock(state->mutex);
+    ++state->generation(word);
+    const auto it = state->index.find(word);
+    if (it != state->index.end()) {
+        it->second->present = false;
+    }
+}
+
+bool CachedBackend::checkWord(std::string_view word) {
+    std::uint64_t issued;
+    {
+        const std::lock_guard lock(state->mutex);
+        if (const Entry* entry = state->lookup(word)) {
+            ++state->hit_count;
+            return entry->present;
+        }
+        ++state->miss_count;
+        issued = state->generation(word);
+    }
+    const bool present = inner->checkWord(word);
+    const std::lock_guard lock(state->mutex);
+    state->remember(word, present, issued);
+    return present;
+}
+
+std::future<bool> CachedBackend::checkWordAsync(std::string word) {
+    std::uint64_t issued;
+    {
+        const std::lock_guard lock(state->mutex);
+        if (const Entry* entry = state->lookup(word)) {
+            ++state->hit_count;
+            std::promise<bool> cached;
+            cached.set_value(entry->present);
+            return cached.get_future();
+        }
+        ++state->miss_count;
+        issued = state->generation(word);
+    }
+    std::future<bool> pending = inner->checkWordAsync(word);
+    if (pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        // Synchronous backends answer here, without a task
+        const bool present = pending.get();
+        {
+            const std::lock_guard lock(state->mutex);
+            state->remember(word, present, issued);
+        }
+        std::promise<bool> answered;
+        answered.set_value(present);
+        return answered.get_future();
+    }
+    std::call_once(worker_started, [this] {
+        worker = std::jthread([state = state](std::stop_token stop) { state->awaitPending(std::move(stop)); });
+    });
+    std::promise<bool> result;
+    std::future<bool> answer = result.get_future();
+    {
+        const std::lock_guard lock(state->mutex);
+        state->pending.push_back(Pending{std::move(word), issued, std::move(pending), std::move(result)});
+    }
+    state->arrived.notify_one();
+    return answer;
+}
+
+std::size_t CachedBackend::hits() const {
+    const std::lock_guard lock(state->mutex);
+    return state->hit_count;
+}
+
+std::size_t CachedBackend::misses() const {
+    const std::lock_guard lock(state->mutex);
+    return state->miss_count;
+}
+
+std::size_t CachedBackend::size() const {
+    const std::lock_guard lock(state->mutex);
+    return state->entries.size();
+}
+
+void CachedBackend::clear() {
+    const std::lock_guard lock(state->mutex);
+    state->index.clear();
+    state->entries.clear();
+    state->hit_count = 0;
+    state->miss_count = 0;
+}
+
+const CachedBackend::Entry* CachedBackend::State::lookup(std::string_view word) {
+    const auto it = index.find(word);
+    if (it == index.end()) {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    return &*it->second;
+}
+
+std::uint64_t& CachedBackend::State::generation(std::string_view word) {
+    return generations[std::hash<std::string_view>{}(word) % stripes];
+}
+
+void CachedBackend::State::remember(std::string_view word, bool present, std::uint64_t issued) {
+    if (max_entries == 0 || generation(word) != issued) {
+        return;
+    }
+    const auto it = index.find(word);
+    if (it != index.end()) {
+        // Another pipelined check of the same word got here first
+        it->second->present = present;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    if (entries.size() >= max_entries) {
+        index.erase(entries.back().word);
+        entries.pop_back();
+    }
+    entries.push_front(Entry{std::string(word), present});
+    index.emplace(entries.front().word, entries.begin());
+}
+
+void CachedBackend::State::awaitPending(std::stop_token stop) {
+    std::unique_lock lock(mutex);
+    for (;;) {
+        arrived.wait(lock, stop, [this] { return !pending.empty(); });
+        if (pending.empty()) {
+            return;  // Stopped with nothing left to wait for
+        }
+        Pending next = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+        // The answers arrive in about the order the checks were issued, so waiting for the oldest first
+        // rarely holds back one that is already there
+        try {
+            const bool present = next.answer.get();
+            lock.lock();
+            remember(next.word, present, next.generation);
+            next.result.set_value(present);
+        } catch (...) {
+            if (!lock.owns_lock()) {
+                lock.lock();
+            }
+            next.result.set_exception(std::current_exception());
+        }
+    }
+}
@@ -0,0 +1,274 @@
+#include "ConcurrentTrie.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <utility>
+
+#include "Trie.h"
+
+namespace {
+
+// Stripe of the reader counters used by the calling thread, fixed for the life of the thread
+std::size_t threadStripe(std::size_t num_stripes) {
+    thread_local const std::size_t hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return hash % num_stripes;
+}
+
+} // namespace
+
+// ====================== CONSTRUCTORS ======================
+
+ConcurrentTrie::ConcurrentTrie() : root(new Node), epoch(0), waiting_parity(0) {}
+
+ConcurrentTrie::ConcurrentTrie(std::initializer_list<std::string> list) : ConcurrentTrie() {
+    // Nobody can read the trie yet, so the words go into the nodes in place instead of being path-copied
+    Node* top = new Node;
+    for (const std::string& word : list) {
+        insertInPlace(top, word);
+    }
+    destroy(root.exchange(top));
+}
+
+ConcurrentTrie::ConcurrentTrie(const Trie& trie) : ConcurrentTrie() {
+    Node* top = new Node;
+    for (const std::string& word : trie.withPrefix("")) {
+        insertInPlace(top, word);
+    }
+    destroy(root.exchange(top));
+}
+
+ConcurrentTrie::~ConcurrentTrie() {
+    destroy(root.load());
+    // Retired nodes are no longer part of any subtree of the root, and their children are either
+    // retired as well or still reachable, so each one is freed on its own
+    for (const Node* node : pending) {
+        delete node;
+    }
+    for (const Node* node : waiting) {
+        delete node;
+    }
+}
+
+// ====================== READER PINS ======================
+
+ConcurrentTrie::ReaderPin::ReaderPin(const ConcurrentTrie& trie) {
+    const std::size_t stripe = threadStripe(num_stripes);
+    for (;;) {
+        const std::uint64_t current = trie.epoch.load();
+        counter = &trie.readers[current & 1][stripe].value;
+        counter->fetch_add(1);
+        // A flip between the load and the increment may already have found this parity drained, in which
+        // case this reader is not protected by it and pins the new epoch instead
+        if (trie.epoch.load() == current) {
+            return;
+        }
+        counter->fetch_sub(1);
+    }
+}
+
+ConcurrentTrie::ReaderPin::~ReaderPin() {
+    // Release orders every read of the nodes before the writer that sees the count drop frees them
+    counter->fetch_sub(1, std::memory_order_release);
+}
+
+// ====================== BASIC OPERATIONS ======================
+
+std::size_t ConcurrentTrie::edgeSlot(const Node* node, unsigned char c) {
+    const auto it = std::lower_bound(node->edges.begin(), node->edges.end(), c, [](const Edge& edge, unsigned char key) {
+        return edge.key < key;
+    });
+    return static_cast<std::size_t>(it - node->edges.begin());
+}
+
+const ConcurrentTrie::Node* ConcurrentTrie::child(const Node* node, unsigned char c) {
+    const std::size_t slot = edgeSlot(node, c);
+    return slot < node->edges.size() && node->edges[slot].key == c ? node->edges[slot].child : nullptr;
+}
+
+const ConcurrentTrie::Node* ConcurrentTrie::find(std::string_view str) const {
+    // Sequentially consistent so the root is read after the pin is visible to writers
+    const Node* node = root.load();
+    for (char c : str) {
+        node = child(node, static_cast<unsigned char>(c));
+        if (!node) {
+            return nullptr;
+        }
+    }
+    return node;
+}
+
+bool ConcurrentTrie::search(std::string_view query) const {
+    const ReaderPin pin(*this);
+    const Node* node = find(query);
+    return node && node->is_finished;
+}
+
+bool ConcurrentTrie::startsWith(std::string_view prefix) const {
+    const ReaderPin pin(*this);
+    return find(prefix) != nullptr;
+}
+
+bool ConcurrentTrie::operator()(std::string_view query) const {
+    return search(query);
+}
+
+void ConcurrentTrie::insertInPlace(Node* node, std::string_view str) {
+    for (char c : str) {
+        const auto key = static_cast<unsigned char>(c);
+        const std::size_t slot = edgeSlot(node, key);
+        if (slot == node->edges.size() || node->edges[slot].key != key) {
+            node->edges.insert(node->edges.begin() + static_cast<std::ptrdiff_t>(slot), Edge{key, new Node});
+        }
+        node = node->edges[slot].child;
+    }
+    node->is_finished = true;
+}
+
+void ConcurrentTrie::insert(std::string_view str) {
+    const std::lock_guard lock(writer);
+    // The part of the word already in the trie, root first; only writers change the root and they hold the lock
+    std::vector<const Node*> path{root.load(std::memory_order_relaxed)};
+    while (path.size() <= str.size()) {
+        const Node* next = child(path.back(), static_cast<unsigned char>(str[path.size() - 1]));
+        if (!next) {
+            break;
+        }
+        path.push_back(next);
+    }
+    const std::size_t depth = path.size() - 1;
+    if (depth == str.size() && path.back()->is_finished) {
+        return;
+    }
+
+    // Fresh nodes for the missing characters, then a copy of every node on the path, bottom-up
+    Node* below;
+    if (depth == str.size()) {
+        below = new Node(*path.back());
+        below->is_finished = true;
+    } else {
+        below = new Node;
+        below->is_finished = true;
+        for (std::size_t i = str.size() - 1; i > depth; --i) {
+            Node* node = new Node;
+            node->edges.push_back(Edge{static_cast<unsigned char>(str[i]), below});
+            below = node;
+        }
+        below = copyWith(path.back(), static_cast<unsigned char>(str[depth]), below);
+    }
+    for (std::size_t i = depth; i-- > 0;) {
+        below = copyWith(path[i], static_cast<unsigned char>(str[i]), below);
+    }
+    publish(below, path);
+}
+
+void ConcurrentTrie::remove(std::string_view str) {
+    const std::lock_guard lock(writer);
+    std::vector<const Node*> path{root.load(std::memory_order_relaxed)};
+    for (char c : str) {
+        const Node* next = child(path.back(), static_cast<unsigned char>(c));
+        if (!next) {
+            return;
+        }
+        path.push_back(next);
+    }
+    if (!path.back()->is_finished) {
+        return;
+    }
+
+    std::size_t depth = str.size();
+    Node* below = nullptr;
+    if (depth == 0 || !path.back()->edges.empty()) {
+        below = new Node(*path.back());
+        below->is_finished = false;
+    } else {
+        // The word ends in a leaf: it is dropped with the ancestors that only led to it, never the root.
+        // Those nodes are retired with the rest of the path instead of being deleted right away
+        while (depth > 1 && !path[depth - 1]->is_finished && path[depth - 1]->edges.size() == 1) {
+            --depth;
+        }
+    }
+    for (std::size_t i = depth; i-- > 0;) {
+        below = copyWith(path[i], static_cast<unsigned char>(str[i]), below);
+    }
+    publish(below, path);
+}
+
+// ====================== RECLAMATION ======================
+
+ConcurrentTrie::Node* ConcurrentTrie::copyWith(const Node* node, unsigned char c, Node* to) {
+    Node* copy = new Node;
+    copy->is_finished = node->is_finished;
+    copy->edges.reserve(node->edges.size() + 1);
+    const std::size_t slot = edgeSlot(node, c);
+    copy->edges.assign(node->edges.begin(), node->edges.begin() + static_cast<std::ptrdiff_t>(slot));
+    if (to) {
+        copy->edges.push_back(Edge{c, to});
+    }
+    const std::size_t rest = slot < node->edges.size() && node->edges[slot].key == c ? slot + 1 : slot;
+    copy->edges.insert(copy->edges.end(), node->edges.begin() + static_cast<std::ptrdiff_t>(rest), node->edges.end());
+    return copy;
+}
+
+void ConcurrentTrie::publish(const Node* next, const std::vector<const Node*>& replaced) {
+    // Every node of the new version not on the path is shared with the old one, so the path is exactly
+    // what no reader arriving from now on can reach
+    root.store(next);
+    pending.insert(pending.end(), replaced.begin(), replaced.end());
+    tryReclaim();
+}
+
+bool ConcurrentTrie::drained(std::size_t parity) const {
+    // No reader can pin this parity any more, so a stripe seen at zero stays free of its readers
+    for (const Counter& counter : readers[parity]) {
+        if (counter.value.load(std::memory_order_acquire) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ConcurrentTrie::tryReclaim() {
+    if (!waiting.empty()) {
+        // Readers that could still hold a waiting node pinned the parity before the flip
+        if (!drained(waiting_parity)) {
+            return;
+        }
+        for (const Node* node : waiting) {
+            delete node;
+        }
+        waiting.clear();
+    }
+    if (!pending.empty()) {
+        // Readers pinned from now on load the current root, which no pending node belongs to
+        waiting.swap(pending);
+        waiting_parity = static_cast<std::size_t>(epoch.fetch_add(1) & 1);
+    }
+}
+
+void ConcurrentTrie::synchronize() {
+    const std::lock_guard lock(writer);
+    while (!waiting.empty() || !pending.empty()) {
+        tryReclaim();
+        if (!waiting.empty()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+std::size_t ConcurrentTrie::retiredCount() const {
+    const std::lock_guard lock(writer);
+    return pending.size() + waiting.size();
+}
+
+void ConcurrentTrie::destroy(const Node* node) {
+    std::vector<const Node*> stack{node};
+    while (!stack.empty()) {
+        const Node* top = stack.back();
+        stack.pop_back();
+        for (const Edge& edge : top->edges) {
+            stack.push_back(edge.child);
+        }
+        delete top;
+    }
+}
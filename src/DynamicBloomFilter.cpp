@@ -0,0 +1,339 @@
+#include "DynamicBloomFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "WordFile.h"
+
+namespace {
+
+void setAll(BitArray& bits, std::size_t num_hashes, const Hash128& h) {
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        bits.set(probePosition(h, i, bits.size()));
+    }
+}
+
+bool testAll(const BitArray& bits, std::size_t num_hashes, const Hash128& h) {
+    for (std::size_t i = 0; i < num_hashes; ++i) {
+        if (!bits.test(probePosition(h, i, bits.size()))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void checkRate(double false_positive_rate) {
+    if (!(false_positive_rate > 0.0 && false_positive_rate < 1.0)) {
+        throw std::invalid_argument("Bloom filter: false_positive_rate must be in (0, 1)");
+    }
+}
+
+} // namespace
+
+// ====================== BIT ARRAY ======================
+
+BitArray::BitArray(std::size_t num_bits)
+    : num_bits(num_bits),
+      num_words((num_bits + 64 * cache_line_words - 1) / (64 * cache_line_words) * cache_line_words),
+      words(num_words ? static_cast<std::uint64_t*>(::operator new[](num_words * sizeof(std::uint64_t), std::align_val_t{64}))
+                      : nullptr) {
+    clear();
+}
+
+BitArray::BitArray(const BitArray& other) : BitArray(other.num_bits) {
+    if (num_words) {
+        std::memcpy(words.get(), other.words.get(), num_words * sizeof(std::uint64_t));
+    }
+}
+
+BitArray::BitArray(BitArray&& other) noexcept
+    : num_bits(other.num_bits), num_words(other.num_words), words(std::move(other.words)) {
+    other.num_bits = 0;
+    other.num_words = 0;
+}
+
+BitArray& BitArray::operator=(const BitArray& other) {
+    if (this != &other) {
+        BitArray copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+BitArray& BitArray::operator=(BitArray&& other) noexcept {
+    if (this != &other) {
+        num_bits = other.num_bits;
+        num_words = other.num_words;
+        words = std::move(other.words);
+        other.num_bits = 0;
+        other.num_words = 0;
+    }
+    return *this;
+}
+
+void BitArray::clear() {
+    if (num_words) {
+        std::memset(words.get(), 0, num_words * sizeof(std::uint64_t));
+    }
+}
+
+// ====================== DYNAMIC BLOOM FILTER ======================
+
+std::size_t DynamicBloomFilter::optimalNumBits(std::size_t n, double p) {
+    checkRate(p);
+    const double ln2 = std::log(2.0);
+    const double m = -static_cast<double>(std::max<std::size_t>(n, 1)) * std::log(p) / (ln2 * ln2);
+    return std::max<std::size_t>(64, static_cast<std::size_t>(std::ceil(m)));
+}
+
+std::size_t DynamicBloomFilter::optimalNumHashes(std::size_t num_bits, std::size_t n) {
+    const double k = static_cast<double>(num_bits) / static_cast<double>(std::max<std::size_t>(n, 1)) * std::log(2.0);
+    return std::max<std::size_t>(1, static_cast<std::size_t>(std::lround(k)));
+}
+
+DynamicBloomFilter::Dimensions DynamicBloomFilter::optimalDimensions(std::size_t n, double p) {
+    const std::size_t num_bits = optimalNumBits(n, p);
+    return Dimensions{num_bits, optimalNumHashes(num_bits, n)};
+}
+
+DynamicBloomFilter::DynamicBloomFilter(Dimensions dimensions, std::shared_ptr<LookupBackend> backend)
+    : bits(dimensions.num_bits), num_hashes(dimensions.num_hashes), server(std::move(backend)) {
+    if (dimensions.num_bits == 0 || dimensions.num_hashes == 0) {
+        throw std::invalid_argument("DynamicBloomFilter: num_bits and num_hashes must be positive");
+    }
+}
+
+DynamicBloomFilter::DynamicBloomFilter(std::size_t expected_items, double false_positive_rate,
+                                       std::shared_ptr<LookupBackend> backend)
+    : DynamicBloomFilter(optimalDimensions(expected_items, false_positive_rate), std::move(backend)) {}
+
+DynamicBloomFilter DynamicBloomFilter::withDimensions(std::size_t num_bits, std::size_t num_hashes,
+                                                      std::shared_ptr<LookupBackend> backend) {
+    return DynamicBloomFilter(Dimensions{num_bits, num_hashes}, std::move(backend));
+}
+
+DynamicBloomFilter::DynamicBloomFilter(const DynamicBloomFilter& other) = default;
+
+DynamicBloomFilter::DynamicBloomFilter(DynamicBloomFilter&& other) noexcept = default;
+
+DynamicBloomFilter& DynamicBloomFilter::operator=(const DynamicBloomFilter& other) = default;
+
+DynamicBloomFilter& DynamicBloomFilter::operator=(DynamicBloomFilter&& other) noexcept = default;
+
+DynamicBloomFilter::~DynamicBloomFilter() = default;
+
+void DynamicBloomFilter::add(const std::string& item) {
+    insert(item);
+}
+
+void DynamicBloomFilter::insert(std::string_view item) {
+    // A moved-from filter has lost its bits; it starts over with a single cache line of them
+    if (bits.size() == 0) {
+        bits = BitArray(BitArray::cache_line_words * 64);
+    }
+    setAll(bits, num_hashes, hash128(item));
+    if (server) {
+        server->addWord(item);
+    }
+}
+
+void DynamicBloomFilter::add(std::string&& file_name) {
+    const bool loaded = forEachWordInFile(file_name, [this](std::string_view word) {
+        insert(word);
+    });
+    if (!loaded) {
+        add(static_cast<const std::string&>(file_name));
+    }
+}
+
+bool DynamicBloomFilter::possiblyContains(std::string_view item) const {
+    return bits.size() && testAll(bits, num_hashes, hash128(item));
+}
+
+bool DynamicBloomFilter::possiblyContains(const std::string& item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+bool DynamicBloomFilter::possiblyContains(const char* item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+bool DynamicBloomFilter::certainlyContains(std::string_view item) const {
+    // Only items that pass the probabilistic check ever reach the server
+    return possiblyContains(item) && server && server->checkWord(item);
+}
+
+bool DynamicBloomFilter::certainlyContains(const std::string& item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+bool DynamicBloomFilter::certainlyContains(const char* item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+void DynamicBloomFilter::reset() {
+    bits.clear();
+}
+
+DynamicBloomFilter DynamicBloomFilter::operator&(const DynamicBloomFilter& other) const {
+    DynamicBloomFilter result(*this);
+    result &= other;
+    return result;
+}
+
+DynamicBloomFilter DynamicBloomFilter::operator|(const DynamicBloomFilter& other) const {
+    DynamicBloomFilter result(*this);
+    result |= other;
+    return result;
+}
+
+DynamicBloomFilter& DynamicBloomFilter::operator&=(const DynamicBloomFilter& other) {
+    if (bits.size() != other.bits.size() || num_hashes != other.num_hashes) {
+        throw std::invalid_argument("DynamicBloomFilter: cannot combine filters of different dimensions");
+    }
+    for (std::size_t w = 0; w < bits.wordCount(); ++w) {
+        bits.data()[w] &= other.bits.data()[w];
+    }
+    return *this;
+}
+
+DynamicBloomFilter& DynamicBloomFilter::operator|=(const DynamicBloomFilter& other) {
+    if (bits.size() != other.bits.size() || num_hashes != other.num_hashes) {
+        throw std::invalid_argument("DynamicBloomFilter: cannot combine filters of different dimensions");
+    }
+    for (std::size_t w = 0; w < bits.wordCount(); ++w) {
+        bits.data()[w] |= other.bits.data()[w];
+    }
+    return *this;
+}
+
+bool DynamicBloomFilter::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+// ====================== SCALABLE BLOOM FILTER ======================
+
+ScalableBloomFilter::ScalableBloomFilter(std::size_t initial_capacity, double false_positive_rate,
+                                         std::shared_ptr<LookupBackend> backend)
+    : initial_capacity(std::max<std::size_t>(initial_capacity, 1)), false_positive_rate(false_positive_rate),
+      server(std::move(backend)) {
+    checkRate(false_positive_rate);
+    addStage();
+}
+
+ScalableBloomFilter::ScalableBloomFilter(const ScalableBloomFilter& other) = default;
+
+ScalableBloomFilter::ScalableBloomFilter(ScalableBloomFilter&& other) noexcept = default;
+
+ScalableBloomFilter& ScalableBloomFilter::operator=(const ScalableBloomFilter& other) = default;
+
+ScalableBloomFilter& ScalableBloomFilter::operator=(ScalableBloomFilter&& other) noexcept = default;
+
+ScalableBloomFilter::~ScalableBloomFilter() = default;
+
+void ScalableBloomFilter::addStage() {
+    // Stage i holds initial_capacity * s^i items at rate p0 * r^i with p0 = p * (1 - r), so the
+    // geometric series of all stage rates sums to at most p
+    const std::size_t index = stages.size();
+    std::size_t capacity = initial_capacity;
+    double rate = false_positive_rate * (1.0 - tightening_ratio);
+    for (std::size_t i = 0; i < index; ++i) {
+        capacity *= growth_factor;
+        rate *= tightening_ratio;
+    }
+    const std::size_t num_bits = DynamicBloomFilter::optimalNumBits(capacity, rate);
+    stages.push_back(Stage{BitArray(num_bits), DynamicBloomFilter::optimalNumHashes(num_bits, capacity), capacity, 0});
+}
+
+void ScalableBloomFilter::add(const std::string& item) {
+    insert(item);
+}
+
+void ScalableBloomFilter::insert(std::string_view item) {
+    const Hash128 h = hash128(item);
+    bool present = false;
+    for (const Stage& stage : stages) {
+        if (testAll(stage.bits, stage.num_hashes, h)) {
+            present = true;
+            break;
+        }
+    }
+    // Re-adding a (possibly) known item would only use up capacity of the current stage
+    if (!present) {
+        // A moved-from filter has no stage left and starts over with a first one
+        if (stages.empty() || stages.back().count >= stages.back().capacity) {
+            addStage();
+        }
+        Stage& stage = stages.back();
+        setAll(stage.bits, stage.num_hashes, h);
+        ++stage.count;
+    }
+    if (server) {
+        server->addWord(item);
+    }
+}
+
+void ScalableBloomFilter::add(std::string&& file_name) {
+    const bool loaded = forEachWordInFile(file_name, [this](std::string_view word) {
+        insert(word);
+    });
+    if (!loaded) {
+        add(static_cast<const std::string&>(file_name));
+    }
+}
+
+bool ScalableBloomFilter::possiblyContains(std::string_view item) const {
+    const Hash128 h = hash128(item);
+    return std::any_of(stages.begin(), stages.end(), [&h](const Stage& stage) {
+        return testAll(stage.bits, stage.num_hashes, h);
+    });
+}
+
+bool ScalableBloomFilter::possiblyContains(const std::string& item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+bool ScalableBloomFilter::possiblyContains(const char* item) const {
+    return possiblyContains(std::string_view(item));
+}
+
+bool ScalableBloomFilter::certainlyContains(std::string_view item) const {
+    // Only items that pass the probabilistic check ever reach the server
+    return possiblyContains(item) && server && server->checkWord(item);
+}
+
+bool ScalableBloomFilter::certainlyContains(const std::string& item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+bool ScalableBloomFilter::certainlyContains(const char* item) const {
+    return certainlyContains(std::string_view(item));
+}
+
+void ScalableBloomFilter::reset() {
+    stages.clear();
+    addStage();
+}
+
+bool ScalableBloomFilter::operator()(std::string_view item) const {
+    return possiblyContains(item);
+}
+
+std::size_t ScalableBloomFilter::size() const {
+    std::size_t total = 0;
+    for (const Stage& stage : stages) {
+        total += stage.count;
+    }
+    return total;
+}
+
+std::size_t ScalableBloomFilter::numBits() const {
+    std::size_t total = 0;
+    for (const Stage& stage : stages) {
+        total += stage.bits.size();
+    }
+    return total;
+}
@@ -0,0 +1,116 @@
+#include "FrozenTrie.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "BloomHash.h" // hash128 for the file checksum
+
+namespace {
+
+std::uint64_t checksum(std::string_view slot_bytes) {
+    return hash128(slot_bytes).h1;
+}
+
+} // namespace
+
+FrozenTrie::FrozenTrie(std::vector<Slot> slots, std::size_t num_words)
+    : owned(std::move(slots)), slots(owned.data()), num_slots(owned.size()), num_words(num_words) {}
+
+FrozenTrie::FrozenTrie(const std::string& file_name, bool verify_checksum)
+    : file(std::make_unique<MappedFile>(file_name)), slots(nullptr), num_slots(0), num_words(0) {
+    if (!file->isOpen()) {
+        throw std::runtime_error("FrozenTrie: cannot open \"" + file_name + "\"");
+    }
+    std::string read;  // Whole file when it cannot be mapped
+    std::string_view bytes = file->view();
+    if (!file->isMapped()) {
+        std::ifstream stream(file_name, std::ios::binary);
+        read.assign(std::istreambuf_iterator<char>(stream), {});
+        bytes = read;
+    }
+
+    frozen_trie_file::Header header;
+    if (bytes.size() < sizeof(header)) {
+        throw std::runtime_error("FrozenTrie file: truncated header");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, frozen_trie_file::magic, sizeof(header.magic)) != 0 ||
+        header.version != frozen_trie_file::version) {
+        throw std::runtime_error("FrozenTrie file: not a frozen trie or unsupported format version");
+    }
+    const std::size_t body = bytes.size() - sizeof(header);
+    if (header.num_slots == 0 || body % sizeof(Slot) != 0 || header.num_slots != body / sizeof(Slot)) {
+        throw std::runtime_error("FrozenTrie file: size does not match its header");
+    }
+    const std::string_view slot_bytes = bytes.substr(sizeof(header));
+    if (verify_checksum && header.checksum != checksum(slot_bytes)) {
+        throw std::runtime_error("FrozenTrie file: checksum mismatch");
+    }
+
+    num_slots = static_cast<std::size_t>(header.num_slots);
+    num_words = static_cast<std::size_t>(header.num_words);
+    if (file->isMapped()) {
+        // The mapping is page-aligned and the slots start right after the 64-byte header
+        slots = reinterpret_cast<const Slot*>(slot_bytes.data());
+    } else {
+        owned.resize(num_slots);
+        std::memcpy(owned.data(), slot_bytes.data(), slot_bytes.size());
+        slots = owned.data();
+        file.reset();
+    }
+}
+
+std::uint32_t FrozenTrie::find(std::string_view str) const {
+    std::uint32_t state = 0;
+    for (char c : str) {
+        // Any base and byte stay within 32 bits, so a corrupt file can only make lookups miss
+        const std::uint32_t next = (slots[state].base & ~terminal) + static_cast<unsigned char>(c);
+        if (next >= num_slots || slots[next].check != state) {
+            return vacant;
+        }
+        state = next;
+    }
+    return state;
+}
+
+bool FrozenTrie::search(std::string_view query) const {
+    const std::uint32_t state = find(query);
+    return state != vacant && (slots[state].base & terminal);
+}
+
+bool FrozenTrie::startsWith(std::string_view prefix) const {
+    return find(prefix) != vacant;
+}
+
+bool FrozenTrie::operator()(std::string_view query) const {
+    return search(query);
+}
+
+void FrozenTrie::save(const std::string& file_name) const {
+    const std::string_view slot_bytes(reinterpret_cast<const char*>(slots), num_slots * sizeof(Slot));
+
+    frozen_trie_file::Header header{};
+    std::memcpy(header.magic, frozen_trie_file::magic, sizeof(header.magic));
+    header.version = frozen_trie_file::version;
+    header.num_slots = num_slots;
+    header.num_words = num_words;
+    header.checksum = checksum(slot_bytes);
+
+    std::ofstream stream(file_name, std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(slot_bytes.data(), static_cast<std::streamsize>(slot_bytes.size()));
+    if (!stream) {
+        throw std::runtime_error("FrozenTrie: cannot write \"" + file_name + "\"");
+    }
+}
+
+MemoryUsage FrozenTrie::memoryUsage() const {
+    MemoryUsage usage;
+    usage.allocated_bytes = sizeof(*this) + owned.capacity() * sizeof(Slot) + (file ? sizeof(MappedFile) + file->view().size() : 0);
+    usage.live_bytes = num_slots * sizeof(Slot);
+    usage.nodes = num_slots;
+    return usage;
+}
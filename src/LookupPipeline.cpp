@@ -0,0 +1,38 @@
+#include "LookupPipeline.h"
+
+LookupPipeline& LookupPipeline::then(std::string name, Check check) {
+    checks.push_back(std::move(check));
+    stage_stats.push_back(StageStats{std::move(name)});
+    return *this;
+}
+
+bool LookupPipeline::contains(std::string_view query) {
+    for (std::size_t i = 0; i < checks.size(); ++i) {
+        StageStats& stats = stage_stats[i];
+        const auto start = std::chrono::steady_clock::now();
+        const Verdict verdict = checks[i](query);
+        stats.time += std::chrono::steady_clock::now() - start;
+        switch (verdict) {
+        case Verdict::Present:
+            ++stats.present;
+            return true;
+        case Verdict::Absent:
+            ++stats.absent;
+            return false;
+        default:
+            ++stats.passed;
+            break;
+        }
+    }
+    return false;
+}
+
+bool LookupPipeline::operator()(std::string_view query) {
+    return contains(query);
+}
+
+void LookupPipeline::resetStats() {
+    for (StageStats& stats : stage_stats) {
+        stats = StageStats{std::move(stats.name)};
+    }
+}
@@ -0,0 +1,160 @@
+#include "LookupStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace lookup_stats {
+
+// ====================== HISTOGRAM ======================
+
+std::uint64_t Histogram::count() const {
+    std::uint64_t total = 0;
+    for (std::uint64_t n : counts) {
+        total += n;
+    }
+    return total;
+}
+
+std::uint64_t Histogram::percentile(double fraction) const {
+    const std::uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    // Rank of the value asked for, 1-based
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(total))));
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket + 1 < num_buckets; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return lowestOf(bucket + 1) - 1;
+        }
+    }
+    return lowestOf(num_buckets - 1);
+}
+
+} // namespace lookup_stats
+
+#if defined(LOOKUP_STATS) && LOOKUP_STATS
+
+namespace lookup_stats {
+
+namespace {
+
+// Cells of one thread. Only the owner writes them, readers load them relaxed while it runs
+struct alignas(64) ThreadBlock {
+    std::array<std::atomic<std::uint64_t>, num_counters> counters{};
+    std::array<std::array<std::atomic<std::uint64_t>, Histogram::num_buckets>, num_timers> latencies{};
+};
+
+void add(std::atomic<std::uint64_t>& cell, std::uint64_t amount) {
+    cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Blocks of the running threads, and the totals of the threads that exited. Never destroyed, so
+// threads that outlive static destruction can still fold their block in
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadBlock*> live;
+    Snapshot exited;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+void addTo(Snapshot& totals, const ThreadBlock& block) {
+    for (std::size_t i = 0; i < num_counters; ++i) {
+        totals.counters[i] += block.counters[i].load(std::memory_order_relaxed);
+    }
+    for (std::size_t t = 0; t < num_timers; ++t) {
+        for (std::size_t b = 0; b < Histogram::num_buckets; ++b) {
+            totals.latencies[t].counts[b] += block.latencies[t][b].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Registers the block of a thread on first use and folds it into the totals when the thread exits
+class ThreadSlot {
+public:
+    ThreadSlot() : block(new ThreadBlock) {
+        Registry& shared = registry();
+        const std::lock_guard lock(shared.mutex);
+        shared.live.push_back(block);
+    }
+    ~ThreadSlot() {
+        Registry& shared = registry();
+        const std::lock_guard lock(shared.mutex);
+        addTo(shared.exited, *block);
+        shared.live.erase(std::find(shared.live.begin(), shared.live.end(), block));
+        delete block;
+    }
+    ThreadSlot(const ThreadSlot&) = delete;
+    ThreadSlot& operator=(const ThreadSlot&) = delete;
+
+    ThreadBlock* const block;
+};
+
+ThreadBlock& local() {
+    thread_local ThreadSlot slot;
+    return *slot.block;
+}
+
+} // namespace
+
+namespace detail {
+
+void bump(Counter counter, std::uint64_t amount) {
+    add(local().counters[static_cast<std::size_t>(counter)], amount);
+}
+
+void record(Timer timer, std::uint64_t ns) {
+    add(local().latencies[static_cast<std::size_t>(timer)][Histogram::bucketOf(ns)], 1);
+}
+
+} // namespace detail
+
+Snapshot snapshot() {
+    Registry& shared = registry();
+    const std::lock_guard lock(shared.mutex);
+    Snapshot totals = shared.exited;
+    for (const ThreadBlock* block : shared.live) {
+        addTo(totals, *block);
+    }
+    return totals;
+}
+
+void reset() {
+    Registry& shared = registry();
+    const std::lock_guard lock(shared.mutex);
+    shared.exited = Snapshot{};
+    for (ThreadBlock* block : shared.live) {
+        for (auto& cell : block->counters) {
+            cell.store(0, std::memory_order_relaxed);
+        }
+        for (auto& histogram : block->latencies) {
+            for (auto& cell : histogram) {
+                cell.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+} // namespace lookup_stats
+
+#else
+
+namespace lookup_stats {
+
+Snapshot snapshot() {
+    return Snapshot{};
+}
+
+void reset() {}
+
+} // namespace lookup_stats
+
+#endif
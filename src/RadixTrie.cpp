@@ -0,0 +1,317 @@
+#include "RadixTrie.h"
+
+#include <algorithm>
+#include <queue>
+#include <stack>
+#include <utility>
+
+#include "WordFile.h"
+
+namespace {
+
+using Node = RadixTrie::Node;
+
+// Position of the child for "c" in a node's children, or of where it would go. Children are ordered by
+// their first label byte, compared unsigned so the order is lexicographic
+std::size_t childSlot(const Node* node, char c) {
+    const auto it = std::lower_bound(node->first_bytes.begin(), node->first_bytes.end(), c, [](char a, char b) {
+        return static_cast<unsigned char>(a) < static_cast<unsigned char>(b);
+    });
+    return static_cast<std::size_t>(it - node->first_bytes.begin());
+}
+
+void insertChild(Node* node, std::size_t slot, std::unique_ptr<Node> child) {
+    child->parent = node;
+    node->first_bytes.insert(node->first_bytes.begin() + static_cast<std::ptrdiff_t>(slot), child->label.front());
+    node->children.insert(node->children.begin() + static_cast<std::ptrdiff_t>(slot), std::move(child));
+}
+
+void eraseChild(Node* node, std::size_t slot) {
+    node->first_bytes.erase(slot, 1);
+    node->children.erase(node->children.begin() + static_cast<std::ptrdiff_t>(slot));
+}
+
+std::size_t commonPrefix(std::string_view a, std::string_view b) {
+    const std::size_t limit = std::min(a.size(), b.size());
+    std::size_t i = 0;
+    while (i < limit && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+void collectWords(const Node* node, std::string& prefix, std::vector<std::string>& words) {
+    const std::size_t length = prefix.size();
+    prefix += node->label;
+    if (node->is_finished) {
+        words.push_back(prefix);
+    }
+    for (const auto& child : node->children) {
+        collectWords(child.get(), prefix, words);
+    }
+    prefix.resize(length);
+}
+
+std::unique_ptr<Node> cloneSubtree(const Node* node, Node* parent) {
+    auto copy = std::make_unique<Node>(node->label, node->is_finished);
+    copy->parent = parent;
+    copy->first_bytes = node->first_bytes;
+    copy->children.reserve(node->children.size());
+    for (const auto& child : node->children) {
+        copy->children.push_back(cloneSubtree(child.get(), copy.get()));
+    }
+    return copy;
+}
+
+// Folds the only child of "node" into it, restoring the invariant that no non-word node has one child
+void mergeWithChild(Node* node) {
+    std::unique_ptr<Node> only = std::move(node->children.front());
+    node->label += only->label;
+    node->is_finished = only->is_finished;
+    node->children = std::move(only->children);
+    node->first_bytes = std::move(only->first_bytes);
+    for (const auto& grandchild : node->children) {
+        grandchild->parent = node;
+    }
+}
+
+} // namespace
+
+// ====================== NODE ======================
+
+RadixTrie::Node::Node(std::string label, bool is_finished)
+    : parent(nullptr), label(std::move(label)), is_finished(is_finished) {}
+
+// ====================== CONSTRUCTORS ======================
+
+RadixTrie::RadixTrie() : root(std::make_unique<Node>()) {}
+
+RadixTrie::RadixTrie(const RadixTrie& other)
+    : root(other.root ? cloneSubtree(other.root.get(), nullptr) : std::make_unique<Node>()) {}
+
+RadixTrie::RadixTrie(RadixTrie&& other) noexcept = default;
+
+RadixTrie::RadixTrie(std::initializer_list<std::string> list) : RadixTrie() {
+    for (const std::string& word : list) {
+        insert(word);
+    }
+}
+
+RadixTrie::~RadixTrie() = default;
+
+RadixTrie& RadixTrie::operator=(const RadixTrie& other) {
+    if (this != &other) {
+        RadixTrie copy(other);
+        std::swap(root, copy.root);
+    }
+    return *this;
+}
+
+RadixTrie& RadixTrie::operator=(RadixTrie&& other) noexcept = default;
+
+// ====================== BASIC OPERATIONS ======================
+
+RadixTrie::Node* RadixTrie::child(const Node* node, char c) {
+    // Nodes have few children, a scan of their packed first bytes beats a binary search
+    const std::size_t slot = node->first_bytes.find(c);
+    return slot != std::string::npos ? node->children[slot].get() : nullptr;
+}
+
+RadixTrie::Node* RadixTrie::find(std::string_view str) const {
+    Node* node = root.get();
+    while (node && !str.empty()) {
+        node = child(node, str.front());
+        if (!node || !str.starts_with(node->label)) {
+            return nullptr;
+        }
+        str.remove_prefix(node->label.size());
+    }
+    return node;
+}
+
+void RadixTrie::insert(std::string_view str) {
+    if (!root) {
+        root = std::make_unique<Node>();
+    }
+    Node* node = root.get();
+    while (!str.empty()) {
+        const std::size_t slot = childSlot(node, str.front());
+        if (slot == node->first_bytes.size() || node->first_bytes[slot] != str.front()) {
+            // No edge starts with this character: the rest of the word becomes one leaf
+            insertChild(node, slot, std::make_unique<Node>(std::string(str), true));
+            return;
+        }
+        Node* next = node->children[slot].get();
+        const std::size_t shared = commonPrefix(str, next->label);
+        if (shared < next->label.size()) {
+            // The word leaves the edge part way: split it at the divergence point
+            auto middle = std::make_unique<Node>(next->label.substr(0, shared));
+            middle->parent = node;
+            next->label.erase(0, shared);
+            insertChild(middle.get(), 0, std::move(node->children[slot]));
+            node->children[slot] = std::move(middle);
+            next = node->children[slot].get();
+        }
+        node = next;
+        str.remove_prefix(shared);
+    }
+    node->is_finished = true;
+}
+
+bool RadixTrie::search(std::string_view query) const {
+    const Node* node = find(query);
+    return node && node->is_finished;
+}
+
+bool RadixTrie::startsWith(std::string_view prefix) const {
+    const Node* node = root.get();
+    while (node && !prefix.empty()) {
+        node = child(node, prefix.front());
+        if (!node) {
+            return false;
+        }
+        // The prefix may end inside an edge label
+        if (prefix.size() <= node->label.size()) {
+            return std::string_view(node->label).starts_with(prefix);
+        }
+        if (!prefix.starts_with(node->label)) {
+            return false;
+        }
+        prefix.remove_prefix(node->label.size());
+    }
+    return node != nullptr;
+}
+
+void RadixTrie::remove(std::string_view str) {
+    Node* node = find(str);
+    if (!node || !node->is_finished) {
+        return;
+    }
+    node->is_finished = false;
+    if (node == root.get()) {
+        return;
+    }
+
+    Node* parent = node->parent;
+    if (node->children.empty()) {
+        eraseChild(parent, childSlot(parent, node->label.front()));
+        node = parent;
+    }
+    // Dropping a word or a leaf can leave a chain that must be compressed again
+    if (node != root.get() && !node->is_finished && node->children.size() == 1) {
+        mergeWithChild(node);
+    }
+}
+
+// ====================== TRAVERSAL ======================
+
+void RadixTrie::bfs(std::function<void(Node*&)> func) {
+    if (!root) {
+        return;
+    }
+    std::queue<Node*> queue;
+    queue.push(root.get());
+    while (!queue.empty()) {
+        Node* node = queue.front();
+        queue.pop();
+        func(node);
+        if (!node) {
+            continue;
+        }
+        for (const auto& child : node->children) {
+            queue.push(child.get());
+        }
+    }
+}
+
+void RadixTrie::dfs(std::function<void(Node*&)> func) {
+    if (!root) {
+        return;
+    }
+    std::stack<Node*> stack;
+    stack.push(root.get());
+    while (!stack.empty()) {
+        Node* node = stack.top();
+        stack.pop();
+        func(node);
+        if (!node) {
+            continue;
+        }
+        // Push in reverse so children are visited in order
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+            stack.push(it->get());
+        }
+    }
+}
+
+std::vector<std::string> RadixTrie::allWords() const {
+    std::vector<std::string> words;
+    if (root) {
+        std::string prefix;
+        collectWords(root.get(), prefix, words);
+    }
+    return words;
+}
+
+// ====================== I/O OPERATORS ======================
+
+std::ostream& operator<<(std::ostream& os, const RadixTrie& trie) {
+    const std::vector<std::string> words = trie.allWords();
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        if (i) {
+            os << ", ";
+        }
+        os << words[i];
+    }
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, RadixTrie& trie) {
+    forEachWordInStream(is, [&trie](std::string_view word) {
+        trie.insert(word);
+    });
+    if (is.eof()) {
+        is.clear(std::ios::eofbit);  // Running into the end of the input is how extraction finishes, not a failure
+    }
+    return is;
+}
+
+// ====================== ADDITIONAL OPERATORS ======================
+
+RadixTrie RadixTrie::operator+(const RadixTrie& other) const {
+    RadixTrie result(*this);
+    result += other;
+    return result;
+}
+
+RadixTrie& RadixTrie::operator+=(const RadixTrie& other) {
+    for (const std::string& word : other.allWords()) {
+        insert(word);
+    }
+    return *this;
+}
+
+RadixTrie RadixTrie::operator-(const RadixTrie& other) const {
+    RadixTrie result(*this);
+    result -= other;
+    return result;
+}
+
+RadixTrie& RadixTrie::operator-=(const RadixTrie& other) {
+    for (const std::string& word : other.allWords()) {
+        remove(word);
+    }
+    return *this;
+}
+
+bool RadixTrie::operator()(std::string_view query) const {
+    return search(query);
+}
+
+bool RadixTrie::operator==(const RadixTrie& other) const {
+    return allWords() == other.allWords();
+}
+
+bool RadixTrie::operator!=(const RadixTrie& other) const {
+    return !(*this == other);
+}
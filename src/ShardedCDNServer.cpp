@@ -0,0 +1,197 @@
+#include "ShardedCDNServer.h"
+
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "LookupStats.h" // Optional operation counters
+
+namespace {
+
+constexpr std::size_t group_width = 16;
+constexpr std::uint8_t empty = 0x80; // Full slots hold a 7-bit tag, so the high bit marks empty ones
+
+// Tag stored in the control byte of a word, the top 7 bits of h2; the bits of h2 above its lowest 7 pick
+// the group. hash128 always sets bit 0 of h2, so starting the group at bit 0 would leave the even groups unused
+std::uint8_t tagOf(const Hash128& hash) {
+    return static_cast<std::uint8_t>(hash.h2 >> 57);
+}
+
+// First group of the probe sequence of "hash" in a table of mask + 1 groups
+std::size_t groupOf(const Hash128& hash, std::size_t mask) {
+    return static_cast<std::size_t>(hash.h2 >> 7) & mask;
+}
+
+// Bit i set for every control byte i of the group at "control" equal to "byte"
+std::uint32_t match(const std::uint8_t* control, std::uint8_t byte) {
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+    const __m128i wanted = _mm_set1_epi8(static_cast<char>(byte));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, wanted)));
+#else
+    std::uint32_t bits = 0;
+    for (std::size_t i = 0; i < group_width; ++i) {
+        bits |= static_cast<std::uint32_t>(control[i] == byte) << i;
+    }
+    return bits;
+#endif
+}
+
+} // namespace
+
+// One shard on a cache line of its own, so that taking its lock does not disturb the neighbours
+struct alignas(64) ShardedCDNServer::Shard {
+    mutable std::shared_mutex mutex;
+    std::vector<std::uint8_t> control = std::vector<std::uint8_t>(group_width, empty); // One byte per slot
+    std::vector<Slot> slots = std::vector<Slot>(group_width);
+    std::string arena;                 // Characters of every word of the shard, back to back
+    std::size_t size = 0;              // Full slots
+    std::atomic<std::size_t> usage{0}; // checkWord calls answered by the shard
+
+    std::size_t groups() const { return control.size() / group_width; }
+    std::string_view word(const Slot& slot) const { return std::string_view(arena).substr(slot.offset, slot.length); }
+};
+
+ShardedCDNServer::ShardedCDNServer(std::size_t num_shards) {
+    if (num_shards == 0) {
+        throw std::invalid_argument("ShardedCDNServer: num_shards must be positive");
+    }
+    shard_bits = static_cast<std::size_t>(std::countr_zero(std::bit_ceil(num_shards)));
+    shards = std::make_unique<Shard[]>(shardCount());
+}
+
+ShardedCDNServer::~ShardedCDNServer() = default;
+
+// Groups are probed triangularly, group + 1, + 2, + 3... modulo their power-of-two count, which visits
+// every group. The load factor stays at most 7/8, so every probe sequence ends on a group with an empty slot
+std::size_t ShardedCDNServer::find(const Shard& shard, std::string_view word, const Hash128& hash) {
+    const std::size_t mask = shard.groups() - 1;
+    const std::uint8_t tag = tagOf(hash);
+    std::size_t group = groupOf(hash, mask);
+    for (std::size_t step = 1;; ++step) {
+        const std::uint8_t* control = shard.control.data() + group * group_width;
+        for (std::uint32_t candidates = match(control, tag); candidates; candidates &= candidates - 1) {
+            const std::size_t slot = group * group_width + static_cast<std::size_t>(std::countr_zero(candidates));
+            if (shard.word(shard.slots[slot]) == word) {
+                return slot;
+            }
+        }
+        if (match(control, empty)) {
+            return npos;
+        }
+        group = (group + step) & mask;
+    }
+}
+
+std::size_t ShardedCDNServer::firstEmpty(const Shard& shard, const Hash128& hash) {
+    const std::size_t mask = shard.groups() - 1;
+    std::size_t group = groupOf(hash, mask);
+    for (std::size_t step = 1;; ++step) {
+        if (const std::uint32_t vacant = match(shard.control.data() + group * group_width, empty)) {
+            return group * group_width + static_cast<std::size_t>(std::countr_zero(vacant));
+        }
+        group = (group + step) & mask;
+    }
+}
+
+void ShardedCDNServer::grow(Shard& shard) {
+    const std::vector<std::uint8_t> old_control =
+        std::exchange(shard.control, std::vector<std::uint8_t>(shard.control.size() * 2, empty));
+    const std::vector<Slot> old_slots = std::exchange(shard.slots, std::vector<Slot>(shard.slots.size() * 2));
+    for (std::size_t i = 0; i < old_control.size(); ++i) {
+        if (old_control[i] != empty) {
+            const Hash128 hash = hash128(shard.word(old_slots[i]));
+            const std::size_t slot = firstEmpty(shard, hash);
+            shard.control[slot] = tagOf(hash);
+            shard.slots[slot] = old_slots[i];
+        }
+    }
+}
+
+void ShardedCDNServer::addWord(std::string_view word) {
+    lookup_stats::count(lookup_stats::Counter::ServerAddWord);
+    lookup_stats::count(lookup_stats::Counter::ServerWordBytes, word.size());
+    const Hash128 hash = hash128(word);
+    Shard& shard = shards[shardOf(hash)];
+    const std::lock_guard lock(shard.mutex);
+    if (find(shard, word, hash) != npos) {
+        return;
+    }
+    if (shard.arena.size() + word.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("ShardedCDNServer: a shard holds at most 4 GiB of characters");
+    }
+    if ((shard.size + 1) * 8 > shard.control.size() * 7) {
+        grow(shard);
+    }
+    const std::size_t slot = firstEmpty(shard, hash);
+    shard.control[slot] = tagOf(hash);
+    shard.slots[slot] = Slot{static_cast<std::uint32_t>(shard.arena.size()), static_cast<std::uint32_t>(word.size())};
+    shard.arena.append(word);
+    ++shard.size;
+}
+
+bool ShardedCDNServer::checkWord(std::string_view word) {
+    return checkWord(word, hash128(word));
+}
+
+bool ShardedCDNServer::checkWord(std::string_view word, const Hash128& hash) {
+    Shard& shard = shards[shardOf(hash)];
+    shard.usage.fetch_add(1, std::memory_order_relaxed);
+    bool found;
+    {
+        const std::shared_lock lock(shard.mutex);
+        found = find(shard, word, hash) != npos;
+    }
+    lookup_stats::count(lookup_stats::Counter::ServerCheckWord);
+    if (found) {
+        lookup_stats::count(lookup_stats::Counter::ServerHit);
+    }
+    return found;
+}
+
+std::size_t ShardedCDNServer::size() const {
+    std::size_t total = 0;
+    for (std::size_t s = 0; s < shardCount(); ++s) {
+        const std::shared_lock lock(shards[s].mutex);
+        total += shards[s].size;
+    }
+    return total;
+}
+
+std::size_t ShardedCDNServer::getUsageCount() const {
+    std::size_t total = 0;
+    for (std::size_t s = 0; s < shardCount(); ++s) {
+        total += shards[s].usage.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double ShardedCDNServer::RAMUsage() const {
+    return static_cast<double>(memoryUsage().allocated_bytes) / 1024.0;
+}
+
+MemoryUsage ShardedCDNServer::memoryUsage() const {
+    MemoryUsage usage{sizeof(*this) + shardCount() * sizeof(Shard), 0, 0};
+    for (std::size_t s = 0; s < shardCount(); ++s) {
+        const Shard& shard = shards[s];
+        const std::shared_lock lock(shard.mutex);
+        usage.allocated_bytes += shard.control.capacity() + shard.slots.capacity() * sizeof(Slot);
+        // Capacity beyond the small-string buffer is on the heap
+        if (shard.arena.capacity() > std::string().capacity()) {
+            usage.allocated_bytes += shard.arena.capacity() + 1;
+        }
+        usage.live_bytes += shard.arena.size();
+        usage.nodes += shard.size;
+    }
+    return usage;
+}
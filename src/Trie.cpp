@@ -1 +1,1087 @@
-#include "Trie.h"
\ No newline at end of file
+#include "Trie.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "BloomHash.h" // hash128 for the binary format checksum
+#include "LookupStats.h"
+#include "WordFile.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TRIE_HAVE_SSE2 1
+#endif
+
+// ====================== NODE ======================
+
+Trie::Node::Node(char data, bool is_finished)
+    : parent(npos), children{npos, npos, npos, npos}, keys{}, child_count(0), kind(Node4), data(data),
+      is_finished(is_finished) {}
+
+// ====================== CHILDREN BLOCKS ======================
+
+namespace {
+
+// Inserts "c" -> "child" into the first "count" entries of sorted "keys"/"nodes"
+template <std::size_t M>
+void insertSorted(std::array<unsigned char, M>& keys, std::array<std::uint32_t, M>& nodes, std::size_t count,
+                  unsigned char c, std::uint32_t child) {
+    std::size_t pos = count;
+    while (pos > 0 && keys[pos - 1] > c) {
+        keys[pos] = keys[pos - 1];
+        nodes[pos] = nodes[pos - 1];
+        --pos;
+    }
+    keys[pos] = c;
+    nodes[pos] = child;
+}
+
+template <std::size_t M>
+void eraseSorted(std::array<unsigned char, M>& keys, std::array<std::uint32_t, M>& nodes, std::size_t count,
+                 unsigned char c) {
+    std::size_t pos = 0;
+    while (keys[pos] != c) {
+        ++pos;
+    }
+    for (; pos + 1 < count; ++pos) {
+        keys[pos] = keys[pos + 1];
+        nodes[pos] = nodes[pos + 1];
+    }
+}
+
+} // namespace
+
+std::uint32_t Trie::child(std::uint32_t index, unsigned char c) const {
+    const Node& node = nodes[index];
+    if (node.kind == Node4) [[likely]] {
+        // Compare the four keys at once: a byte of "diff" is zero where the key is "c". The lowest flagged
+        // byte is always a true match, higher ones may be borrows of it, and unused slots are masked off.
+        // Key i is placed in byte i explicitly, so the argument holds whatever the byte order; on
+        // little-endian targets this compiles to a single load
+        const std::uint32_t keys = std::uint32_t{node.keys[0]} | std::uint32_t{node.keys[1]} << 8 |
+                                   std::uint32_t{node.keys[2]} << 16 | std::uint32_t{node.keys[3]} << 24;
+        const std::uint32_t diff = keys ^ (0x01010101u * c);
+        const std::uint32_t live = static_cast<std::uint32_t>((std::uint64_t{1} << (8 * node.child_count)) - 1);
+        const std::uint32_t hits = (diff - 0x01010101u) & ~diff & 0x80808080u & live;
+        return hits ? node.children[std::countr_zero(hits) / 8] : Node::npos;
+    }
+    switch (node.kind) {
+    case Node16: {
+        const Children16& block = children16[node.children[0]];
+#if defined(TRIE_HAVE_SSE2)
+        // One compare of all 16 keys, masked down to the live ones
+        const __m128i keys = _mm_load_si128(reinterpret_cast<const __m128i*>(block.keys.data()));
+        const __m128i hits = _mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(c)));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits)) & ((1u << node.child_count) - 1);
+        return mask ? block.nodes[std::countr_zero(mask)] : Node::npos;
+#else
+        for (std::size_t i = 0; i < node.child_count; ++i) {
+            if (block.keys[i] == c) {
+                return block.nodes[i];
+            }
+        }
+        return Node::npos;
+#endif
+    }
+    case Node48: {
+        const Children48& block = children48[node.children[0]];
+        return block.slot[c] ? block.nodes[block.slot[c] - 1] : Node::npos;
+    }
+    default:
+        return children256[node.children[0]].nodes[c];
+    }
+}
+
+void Trie::releaseChildren(Node& node) {
+    switch (node.kind) {
+    case Node4: break;
+    case Node16: children16.release(node.children[0]); break;
+    case Node48: children48.release(node.children[0]); break;
+    default: children256.release(node.children[0]); break;
+    }
+    node.children.fill(Node::npos);
+}
+
+void Trie::regroup(Node& node, Kind kind) {
+    std::array<std::uint32_t, 256> live;
+    std::size_t count = 0;
+    forEachChild(node, [&live, &count](std::uint32_t child) { live[count++] = child; });
+    releaseChildren(node);
+
+    const auto key = [this](std::uint32_t child) { return static_cast<unsigned char>(nodes[child].data); };
+    switch (kind) {
+    case Node4:
+        for (std::size_t i = 0; i < count; ++i) {
+            node.keys[i] = key(live[i]);
+            node.children[i] = live[i];
+        }
+        break;
+    case Node16: {
+        Children16 block{};
+        for (std::size_t i = 0; i < count; ++i) {
+            block.keys[i] = key(live[i]);
+            block.nodes[i] = live[i];
+        }
+        node.children[0] = children16.allocate(block);
+        break;
+    }
+    case Node48: {
+        Children48 block{};
+        for (std::size_t i = 0; i < count; ++i) {
+            block.slot[key(live[i])] = static_cast<std::uint8_t>(i + 1);
+            block.nodes[i] = live[i];
+        }
+        node.children[0] = children48.allocate(block);
+        break;
+    }
+    default: {
+        Children256 block;
+        block.nodes.fill(Node::npos);
+        for (std::size_t i = 0; i < count; ++i) {
+            block.nodes[key(live[i])] = live[i];
+        }
+        node.children[0] = children256.allocate(block);
+        break;
+    }
+    }
+    node.kind = kind;
+}
+
+void Trie::addChild(std::uint32_t index, unsigned char c, std::uint32_t child) {
+    Node& node = nodes[index];
+    const std::size_t count = node.child_count;
+    if ((node.kind == Node4 && count == 4) || (node.kind == Node16 && count == 16) ||
+               (node.kind == Node48 && count == 48)) {
+        regroup(node, static_cast<Kind>(node.kind + 1));
+    }
+    switch (node.kind) {
+    case Node4:
+        insertSorted(node.keys, node.children, count, c, child);
+        break;
+    case Node16: {
+        Children16& block = children16[node.children[0]];
+        insertSorted(block.keys, block.nodes, count, c, child);
+        break;
+    }
+    case Node48: {
+        Children48& block = children48[node.children[0]];
+        block.nodes[count] = child;
+        block.slot[c] = static_cast<std::uint8_t>(count + 1);
+        break;
+    }
+    default:
+        children256[node.children[0]].nodes[c] = child;
+        break;
+    }
+    ++node.child_count;
+}
+
+void Trie::removeChild(std::uint32_t index, unsigned char c) {
+    Node& node = nodes[index];
+    const std::size_t count = node.child_count;
+    switch (node.kind) {
+    case Node4:
+        eraseSorted(node.keys, node.children, count, c);
+        break;
+    case Node16: {
+        Children16& block = children16[node.children[0]];
+        eraseSorted(block.keys, block.nodes, count, c);
+        break;
+    }
+    case Node48: {
+        // Keep the occupied slots dense by moving the last one into the hole
+        Children48& block = children48[node.children[0]];
+        const std::size_t hole = block.slot[c] - 1;
+        const std::uint32_t last = block.nodes[count - 1];
+        block.nodes[hole] = last;
+        block.slot[static_cast<unsigned char>(nodes[last].data)] = static_cast<std::uint8_t>(hole + 1);
+        block.slot[c] = 0;
+        break;
+    }
+    default:
+        children256[node.children[0]].nodes[c] = Node::npos;
+        break;
+    }
+    --node.child_count;
+
+    // Shrink below the growth thresholds so that alternating inserts and removals do not thrash
+    if (node.kind == Node16 && node.child_count <= 3) {
+        regroup(node, Node4);
+    } else if (node.kind == Node48 && node.child_count <= 12) {
+        regroup(node, Node16);
+    } else if (node.kind == Node256 && node.child_count <= 37) {
+        regroup(node, Node48);
+    }
+}
+
+std::uint32_t Trie::newNode(char data, std::uint32_t parent) {
+    lookup_stats::count(lookup_stats::Counter::TrieNodesCreated);
+    Node node(data);
+    node.parent = parent;
+    const std::uint32_t index = nodes.allocate(node);
+    if (!weights.empty()) {
+        if (index >= weights.size()) {
+            weights.resize(index + 1);
+        }
+        weights[index] = Weight{0, 0};
+    }
+    return index;
+}
+
+// ====================== CONSTRUCTORS ======================
+
+Trie::Trie() {
+    newNode('\0', Node::npos);
+}
+
+Trie::Trie(const Trie& other)
+    : nodes(other.nodes), children16(other.children16), children48(other.children48),
+      children256(other.children256), weights(other.weights) {
+    if (nodes.empty()) {
+        newNode('\0', Node::npos);
+    }
+}
+
+// A moved-from trie behaves as an empty one
+Trie::Trie(Trie&& other)
+    : nodes(std::move(other.nodes)), children16(std::move(other.children16)), children48(std::move(other.children48)),
+      children256(std::move(other.children256)), weights(std::move(other.weights)) {
+    other.weights.clear();
+}
+
+Trie::Trie(std::initializer_list<std::string> list) : Trie() {
+    for (const std::string& word : list) {
+        insert(word);
+    }
+}
+
+Trie::~Trie() = default;
+
+Trie& Trie::operator=(const Trie& other) {
+    if (this != &other) {
+        Trie copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Trie& Trie::operator=(Trie&& other) {
+    if (this != &other) {
+        nodes = std::move(other.nodes);
+        children16 = std::move(other.children16);
+        children48 = std::move(other.children48);
+        children256 = std::move(other.children256);
+        weights = std::move(other.weights);
+        other.weights.clear();
+    }
+    return *this;
+}
+
+// ====================== BULK CONSTRUCTION ======================
+
+Trie Trie::fromFile(const std::string& file_name, unsigned int num_threads) {
+    // Views into the mapping stay valid while "file" is open
+    MappedFile file(file_name);
+    if (!file.isOpen()) {
+        throw std::runtime_error("Trie: cannot open word file \"" + file_name + "\"");
+    }
+    if (file.isMapped()) {
+        std::vector<std::string_view> words;
+        forEachWord(file.view(), [&words](std::string_view word) { words.push_back(word); });
+        return fromWords(words, num_threads);
+    }
+    std::vector<std::string> words;
+    std::ifstream stream(file_name, std::ios::binary);
+    forEachWordInStream(stream, [&words](std::string_view word) { words.emplace_back(word); });
+    return fromWords(words, num_threads);
+}
+
+void Trie::attach(Trie&& part) {
+    if (part.nodes.empty()) {
+        return;
+    }
+    if (nodes.empty()) {
+        newNode('\0', Node::npos);
+    }
+    const std::uint32_t node_offset = nodes.append(part.nodes);
+    const std::uint32_t offset16 = children16.append(part.children16);
+    const std::uint32_t offset48 = children48.append(part.children48);
+    const std::uint32_t offset256 = children256.append(part.children256);
+
+    // Shift every index held by the appended nodes and blocks. Parts are only ever inserted into, so
+    // all of their nodes are live; blocks they freed while growing are owned by no node and left alone
+    for (std::uint32_t index = node_offset; index < nodes.extent(); ++index) {
+        Node& node = nodes[index];
+        if (node.parent != Node::npos) {
+            node.parent += node_offset;
+        }
+        switch (node.kind) {
+        case Node4:
+            for (std::size_t i = 0; i < node.child_count; ++i) {
+                node.children[i] += node_offset;
+            }
+            break;
+        case Node16: {
+            node.children[0] += offset16;
+            Children16& block = children16[node.children[0]];
+            for (std::size_t i = 0; i < node.child_count; ++i) {
+                block.nodes[i] += node_offset;
+            }
+            break;
+        }
+        case Node48: {
+            node.children[0] += offset48;
+            Children48& block = children48[node.children[0]];
+            for (std::size_t i = 0; i < node.child_count; ++i) {
+                block.nodes[i] += node_offset;
+            }
+            break;
+        }
+        default:
+            node.children[0] += offset256;
+            for (std::uint32_t& child : children256[node.children[0]].nodes) {
+                if (child != Node::npos) {
+                    child += node_offset;
+                }
+            }
+            break;
+        }
+    }
+
+    // Hang the children of the part's root under ours and drop the part's root
+    Node& part_root = nodes[node_offset];
+    nodes[root].is_finished = nodes[root].is_finished || part_root.is_finished;
+    std::array<std::uint32_t, 256> moved;
+    std::size_t count = 0;
+    forEachChild(part_root, [&moved, &count](std::uint32_t child) { moved[count++] = child; });
+    for (std::size_t i = 0; i < count; ++i) {
+        nodes[moved[i]].parent = root;
+        addChild(root, static_cast<unsigned char>(nodes[moved[i]].data), moved[i]);
+    }
+    releaseChildren(part_root);
+    nodes.release(node_offset);
+    const Trie spent(std::move(part));  // Frees the part's pools now rather than with the caller's
+}
+
+// ====================== BASIC OPERATIONS ======================
+
+std::uint32_t Trie::find(std::string_view str) const {
+    if (nodes.empty()) {
+        return Node::npos;
+    }
+    std::uint32_t index = root;
+    for (char c : str) {
+        index = child(index, static_cast<unsigned char>(c));
+        if (index == Node::npos) {
+            return Node::npos;
+        }
+    }
+    return index;
+}
+
+std::uint32_t Trie::findOrCreate(std::string_view str) {
+    if (nodes.empty()) {
+        newNode('\0', Node::npos);
+    }
+    std::uint32_t index = root;
+    for (char c : str) {
+        std::uint32_t next = child(index, static_cast<unsigned char>(c));
+        if (next == Node::npos) {
+            next = newNode(c, index);
+            addChild(index, static_cast<unsigned char>(c), next);
+        }
+        index = next;
+    }
+    return index;
+}
+
+void Trie::insert(const std::string& str) {
+    lookup_stats::count(lookup_stats::Counter::TrieInsert);
+    nodes[findOrCreate(str)].is_finished = true;
+}
+
+void Trie::insert(const std::string& str, std::uint32_t weight) {
+    lookup_stats::count(lookup_stats::Counter::TrieInsert);
+    const std::uint32_t index = findOrCreate(str);
+    nodes[index].is_finished = true;
+    if (weights.empty()) {
+        weights.resize(nodes.extent(), Weight{0, 0});
+    }
+    weights[index].own = weight;
+    updateWeights(index);
+}
+
+bool Trie::search(std::string_view query) const {
+    const lookup_stats::ScopedTimer timer(lookup_stats::Timer::TrieSearch);
+    lookup_stats::count(lookup_stats::Counter::TrieSearch);
+    const std::uint32_t index = find(query);
+    return index != Node::npos && nodes[index].is_finished;
+}
+
+bool Trie::startsWith(std::string_view prefix) const {
+    const lookup_stats::ScopedTimer timer(lookup_stats::Timer::TrieStartsWith);
+    lookup_stats::count(lookup_stats::Counter::TrieStartsWith);
+    return find(prefix) != Node::npos;
+}
+
+void Trie::remove(const std::string& str) {
+    lookup_stats::count(lookup_stats::Counter::TrieRemove);
+    std::uint32_t index = find(str);
+    if (index == Node::npos || !nodes[index].is_finished) {
+        return;
+    }
+    nodes[index].is_finished = false;
+    if (!weights.empty()) {
+        weights[index].own = 0;
+    }
+
+    // Remove the trace of nodes that no longer lead to any word
+    while (index != root && !nodes[index].is_finished && !hasChildren(index)) {
+        const std::uint32_t parent = nodes[index].parent;
+        removeChild(parent, static_cast<unsigned char>(nodes[index].data));
+        nodes.release(index);
+        lookup_stats::count(lookup_stats::Counter::TrieNodesPruned);
+        index = parent;
+    }
+    if (!weights.empty()) {
+        updateWeights(index);
+    }
+}
+
+// ====================== AUTOCOMPLETION ======================
+
+std::uint32_t Trie::nextChild(const Node& node, std::uint32_t& cursor) const {
+    switch (node.kind) {
+    case Node4:
+        return cursor < node.child_count ? node.children[cursor++] : Node::npos;
+    case Node16:
+        return cursor < node.child_count ? children16[node.children[0]].nodes[cursor++] : Node::npos;
+    case Node48: {
+        // Cursors of the byte-indexed kinds are the next byte to look at
+        const Children48& block = children48[node.children[0]];
+        while (cursor < 256) {
+            const std::uint8_t slot = block.slot[cursor++];
+            if (slot) {
+                return block.nodes[slot - 1];
+            }
+        }
+        return Node::npos;
+    }
+    default: {
+        const Children256& block = children256[node.children[0]];
+        while (cursor < 256) {
+            const std::uint32_t child = block.nodes[cursor++];
+            if (child != Node::npos) {
+                return child;
+            }
+        }
+        return Node::npos;
+    }
+    }
+}
+
+Trie::PrefixIterator::PrefixIterator(const Trie& trie, std::string_view prefix, std::size_t limit)
+    : trie(&trie), word(prefix), remaining(limit) {
+    const std::uint32_t start = trie.find(prefix);
+    if (limit == 0 || start == Node::npos) {
+        return;
+    }
+    stack.push_back(Frame{start, 0});
+    if (!trie.nodes[start].is_finished) {
+        advance();
+    }
+}
+
+Trie::PrefixIterator& Trie::PrefixIterator::operator++() {
+    if (--remaining == 0) {
+        stack.clear();
+    } else {
+        advance();
+    }
+    return *this;
+}
+
+void Trie::PrefixIterator::advance() {
+    // Pre-order walk: a word is reached before every longer word below it
+    while (!stack.empty()) {
+        const std::uint32_t next = trie->nextChild(trie->nodes[stack.back().node], stack.back().cursor);
+        if (next != Node::npos) {
+            word.push_back(trie->nodes[next].data);
+            stack.push_back(Frame{next, 0});
+            if (trie->nodes[next].is_finished) {
+                return;
+            }
+            continue;
+        }
+        stack.pop_back();
+        if (!stack.empty()) {
+            word.pop_back();
+        }
+    }
+}
+
+static_assert(std::input_iterator<Trie::PrefixIterator>);
+
+Trie::PrefixRange Trie::withPrefix(std::string_view prefix, std::size_t limit) const {
+    return PrefixRange(*this, prefix, limit);
+}
+
+std::uint32_t Trie::subtreeWeight(std::uint32_t index) const {
+    std::uint32_t largest = nodes[index].is_finished ? weights[index].own : 0;
+    forEachChild(nodes[index], [this, &largest](std::uint32_t child) {
+        largest = std::max(largest, weights[child].subtree);
+    });
+    return largest;
+}
+
+void Trie::updateWeights(std::uint32_t index) {
+    for (; index != Node::npos; index = nodes[index].parent) {
+        const std::uint32_t largest = subtreeWeight(index);
+        if (weights[index].subtree == largest) {
+            break;  // The ancestors already agree
+        }
+        weights[index].subtree = largest;
+    }
+}
+
+std::string Trie::wordAt(std::uint32_t index) const {
+    std::string word;
+    for (; index != root; index = nodes[index].parent) {
+        word.push_back(nodes[index].data);
+    }
+    std::reverse(word.begin(), word.end());
+    return word;
+}
+
+std::vector<std::pair<std::string, std::uint32_t>> Trie::topK(std::string_view prefix, std::size_t k) const {
+    std::vector<std::pair<std::string, std::uint32_t>> best;
+    const std::uint32_t start = find(prefix);
+    if (k == 0 || start == Node::npos) {
+        return best;
+    }
+    const auto weightOf = [this](std::uint32_t index) {
+        return weights.empty() ? Weight{0, 0} : weights[index];
+    };
+
+    // Best-first search where a subtree is ranked by the largest weight in it and a word by its own.
+    // Once k words came out of the queue, everything left in it weighs no more than they do
+    struct Candidate {
+        std::uint32_t weight;
+        std::uint64_t order; // Tie-break on insertion order, which the breadth-first expansion keeps by length
+        std::uint32_t node;
+        bool is_word;
+        bool operator<(const Candidate& other) const {
+            return weight != other.weight ? weight < other.weight : order > other.order;
+        }
+    };
+    std::priority_queue<Candidate> queue;
+    std::uint64_t order = 0;
+    queue.push(Candidate{weightOf(start).subtree, order++, start, false});
+    while (!queue.empty() && best.size() < k) {
+        const Candidate top = queue.top();
+        queue.pop();
+        if (top.is_word) {
+            best.emplace_back(wordAt(top.node), top.weight);
+            continue;
+        }
+        const Node& node = nodes[top.node];
+        if (node.is_finished) {
+            queue.push(Candidate{weightOf(top.node).own, order++, top.node, true});
+        }
+        forEachChild(node, [&](std::uint32_t child) {
+            queue.push(Candidate{weightOf(child).subtree, order++, child, false});
+        });
+    }
+    return best;
+}
+
+std::uint32_t Trie::weight(std::string_view word) const {
+    const std::uint32_t index = find(word);
+    return index != Node::npos && nodes[index].is_finished && !weights.empty() ? weights[index].own : 0;
+}
+
+// ====================== FREEZING ======================
+
+FrozenTrie Trie::freeze() const {
+    using Slot = FrozenTrie::Slot;
+    std::vector<Slot> slots{Slot{0, FrozenTrie::vacant}};
+    std::vector<bool> used{true};
+    std::size_t num_words = 0;
+    if (nodes.empty()) {
+        return FrozenTrie(std::move(slots), 0);
+    }
+
+    // States are placed breadth-first; the children of each one go to the lowest base at which all of
+    // their slots are still vacant. Scanning from the first vacant slot keeps the array dense
+    std::size_t first_vacant = 1;
+    std::queue<std::pair<std::uint32_t, std::uint32_t>> queue; // Trie node and the state it became
+    queue.emplace(root, 0);
+    std::vector<std::uint32_t> children;
+    while (!queue.empty()) {
+        const auto [index, state] = queue.front();
+        queue.pop();
+        const Node& node = nodes[index];
+        if (node.is_finished) {
+            slots[state].base |= FrozenTrie::terminal;
+            ++num_words;
+        }
+        children.clear();
+        forEachChild(node, [&children](std::uint32_t child) { children.push_back(child); });
+        if (children.empty()) {
+            continue;
+        }
+
+        const auto label = [this](std::uint32_t child) { return static_cast<unsigned char>(nodes[child].data); };
+        const auto isVacant = [&used](std::size_t slot) { return slot >= used.size() || !used[slot]; };
+        while (!isVacant(first_vacant)) {
+            ++first_vacant;
+        }
+        std::size_t base = 0;
+        for (std::size_t slot = std::max<std::size_t>(first_vacant, label(children.front()) + 1);; ++slot) {
+            if (!isVacant(slot)) {
+                continue;
+            }
+            base = slot - label(children.front());
+            if (std::all_of(children.begin() + 1, children.end(),
+                            [&](std::uint32_t child) { return isVacant(base + label(child)); })) {
+                break;
+            }
+        }
+        const std::size_t end = base + label(children.back()) + 1;
+        if (end > FrozenTrie::terminal) {
+            throw std::length_error("Trie: too many nodes to freeze");
+        }
+        if (end > slots.size()) {
+            slots.resize(end, Slot{0, FrozenTrie::vacant});
+            used.resize(end, false);
+        }
+
+        slots[state].base |= static_cast<std::uint32_t>(base);
+        for (std::uint32_t child : children) {
+            const std::size_t slot = base + label(child);
+            used[slot] = true;
+            slots[slot].check = state;
+            queue.emplace(child, static_cast<std::uint32_t>(slot));
+        }
+    }
+    return FrozenTrie(std::move(slots), num_words);
+}
+
+// ====================== BINARY FORMAT ======================
+
+namespace {
+
+std::uint64_t checksum(std::string_view body) {
+    return hash128(body).h1;
+}
+
+// Header at the start of "bytes", throwing std::runtime_error unless it is a supported dump header
+trie_file::Header readHeader(std::string_view bytes) {
+    trie_file::Header header;
+    if (bytes.size() < sizeof(header)) {
+        throw std::runtime_error("Trie file: truncated header");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, trie_file::magic, sizeof(header.magic)) != 0 ||
+        header.version != trie_file::version) {
+        throw std::runtime_error("Trie file: not a trie dump or unsupported format version");
+    }
+    return header;
+}
+
+} // namespace
+
+void Trie::save(std::ostream& os) const {
+    const bool weighted = !weights.empty();
+    std::string body;
+    std::uint64_t num_nodes = 0;
+    std::uint64_t num_words = 0;
+    if (nodes.empty()) {
+        body.assign(2, '\0');
+        num_nodes = 1;
+    } else {
+        body.reserve(nodes.size() * (weighted ? 2 + sizeof(std::uint32_t) : 2));
+        // Node and the flags its parent already knows; children are pushed in reverse so they come out in
+        // byte order, the last one first
+        std::vector<std::pair<std::uint32_t, std::uint8_t>> stack{{root, 0}};
+        while (!stack.empty()) {
+            auto [index, flags] = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+            if (node.is_finished) {
+                flags |= trie_file::finished;
+                ++num_words;
+            }
+            if (node.child_count != 0) {
+                flags |= trie_file::has_children;
+            }
+            body.push_back(index == root ? '\0' : node.data);
+            body.push_back(static_cast<char>(flags));
+            if (weighted) {
+                char own[sizeof(std::uint32_t)];
+                std::memcpy(own, &weights[index].own, sizeof(own));
+                body.append(own, sizeof(own));
+            }
+            ++num_nodes;
+
+            std::uint8_t last = trie_file::last_child;
+            forEachChild(node, [&stack, &last](std::uint32_t child) {
+                stack.emplace_back(child, last);
+                last = 0;
+            }, true);
+        }
+    }
+
+    trie_file::Header header{};
+    std::memcpy(header.magic, trie_file::magic, sizeof(header.magic));
+    header.version = trie_file::version;
+    header.flags = weighted ? trie_file::has_weights : 0;
+    header.num_nodes = num_nodes;
+    header.num_words = num_words;
+    header.body_bytes = body.size();
+    header.checksum = checksum(body);
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(body.data(), static_cast<std::streamsize>(body.size()));
+    if (!os) {
+        throw std::runtime_error("Trie: cannot write binary dump");
+    }
+}
+
+void Trie::save(const std::string& file_name) const {
+    std::ofstream stream(file_name, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        throw std::runtime_error("Trie: cannot write \"" + file_name + "\"");
+    }
+    save(stream);
+}
+
+Trie Trie::load(std::istream& is, bool verify_checksum) {
+    std::string bytes(sizeof(trie_file::Header), '\0');
+    is.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    bytes.resize(static_cast<std::size_t>(is.gcount()));
+    const trie_file::Header header = readHeader(bytes);
+    // Bound the body by the node count before trusting it with an allocation
+    if (header.num_nodes >= Node::npos || header.body_bytes > header.num_nodes * (2 + sizeof(std::uint32_t))) {
+        throw std::runtime_error("Trie file: size does not match its header");
+    }
+    bytes.resize(sizeof(header) + header.body_bytes);
+    is.read(bytes.data() + sizeof(header), static_cast<std::streamsize>(header.body_bytes));
+    if (static_cast<std::uint64_t>(is.gcount()) != header.body_bytes) {
+        throw std::runtime_error("Trie file: truncated body");
+    }
+    return decode(bytes, verify_checksum);
+}
+
+Trie Trie::load(const std::string& file_name, bool verify_checksum) {
+    MappedFile file(file_name);
+    if (!file.isOpen()) {
+        throw std::runtime_error("Trie: cannot open \"" + file_name + "\"");
+    }
+    if (file.isMapped()) {
+        return decode(file.view(), verify_checksum);
+    }
+    std::ifstream stream(file_name, std::ios::binary);
+    return load(stream, verify_checksum);
+}
+
+Trie Trie::decode(std::string_view bytes, bool verify_checksum) {
+    const trie_file::Header header = readHeader(bytes);
+    const std::string_view body = bytes.substr(sizeof(header));
+    const bool weighted = header.flags & trie_file::has_weights;
+    const std::size_t record = weighted ? 2 + sizeof(std::uint32_t) : 2;
+    if (header.num_nodes == 0 || header.num_nodes >= Node::npos || body.size() != header.body_bytes ||
+        body.size() != header.num_nodes * record) {
+        throw std::runtime_error("Trie file: size does not match its header");
+    }
+    if (verify_checksum && header.checksum != checksum(body)) {
+        throw std::runtime_error("Trie file: checksum mismatch");
+    }
+
+    // Records come in preorder, so nodes are allocated in the order they are read and every node gets a
+    // higher index than its parent. "open" holds the nodes whose children are still coming, with the byte
+    // of the latest one to check that they are in order
+    Trie trie;
+    if (weighted) {
+        trie.weights.resize(static_cast<std::size_t>(header.num_nodes));
+    }
+    struct Open {
+        std::uint32_t index;
+        int last_key;
+    };
+    std::vector<Open> open;
+    for (std::size_t pos = 0; pos < body.size(); pos += record) {
+        const auto key = static_cast<unsigned char>(body[pos]);
+        const auto flags = static_cast<std::uint8_t>(body[pos + 1]);
+        std::uint32_t index = root;
+        if (pos != 0) {
+            if (open.empty() || key <= open.back().last_key ||
+                !(flags & (trie_file::finished | trie_file::has_children))) {
+                throw std::runtime_error("Trie file: malformed node records");
+            }
+            const std::uint32_t parent = open.back().index;
+            open.back().last_key = key;
+            if (flags & trie_file::last_child) {
+                open.pop_back();
+            }
+            index = trie.newNode(static_cast<char>(key), parent);
+            trie.addChild(parent, key, index);
+        }
+        trie.nodes[index].is_finished = flags & trie_file::finished;
+        if (weighted) {
+            std::memcpy(&trie.weights[index].own, body.data() + pos + 2, sizeof(std::uint32_t));
+            trie.weights[index].subtree = trie.weights[index].own;
+        }
+        if (flags & trie_file::has_children) {
+            open.push_back(Open{index, -1});
+        }
+    }
+    if (!open.empty()) {
+        throw std::runtime_error("Trie file: malformed node records");
+    }
+
+    // Children have higher indices than their parents, so one backward pass settles every subtree weight
+    if (weighted) {
+        for (std::size_t index = trie.nodes.extent(); index-- > 1;) {
+            Weight& parent = trie.weights[trie.nodes[static_cast<std::uint32_t>(index)].parent];
+            parent.subtree = std::max(parent.subtree, trie.weights[index].subtree);
+        }
+    }
+    return trie;
+}
+
+// ====================== MEMORY ACCOUNTING ======================
+
+MemoryUsage Trie::memoryUsage() const {
+    MemoryUsage usage;
+    usage.allocated_bytes = sizeof(*this) + nodes.allocatedBytes() + children16.allocatedBytes() +
+                            children48.allocatedBytes() + children256.allocatedBytes() +
+                            weights.capacity() * sizeof(Weight);
+    usage.live_bytes = nodes.size() * sizeof(Node) + children16.size() * sizeof(Children16) +
+                       children48.size() * sizeof(Children48) + children256.size() * sizeof(Children256) +
+                       (weights.empty() ? 0 : nodes.size() * sizeof(Weight));
+    usage.nodes = nodes.size();
+    return usage;
+}
+
+double Trie::RAMUsage() const {
+    return static_cast<double>(memoryUsage().allocated_bytes) / 1024.0;
+}
+
+// ====================== TRAVERSAL ======================
+
+void Trie::bfs(std::function<void(Node*&)> func) {
+    visit_bfs(func);
+}
+
+void Trie::dfs(std::function<void(Node*&)> func) {
+    visit_dfs(func);
+}
+
+// ====================== I/O OPERATORS ======================
+
+// Words are written in lexicographic order and separated by ", ", the same format as the word data sets
+std::ostream& operator<<(std::ostream& os, const Trie& trie) {
+    const char* separator = "";
+    for (const std::string& word : trie.withPrefix("")) {
+        os << separator << word;
+        separator = ", ";
+    }
+    return os;
+}
+
+// Reads the rest of the stream as ", "-separated words and inserts every one of them
+std::istream& operator>>(std::istream& is, Trie& trie) {
+    forEachWordInStream(is, [&trie](std::string_view word) {
+        trie.insert(std::string(word));
+    });
+    if (is.eof()) {
+        is.clear(std::ios::eofbit);  // Running into the end of the input is how extraction finishes, not a failure
+    }
+    return is;
+}
+
+// ====================== ADDITIONAL OPERATORS ======================
+
+Trie Trie::operator+(const Trie& other) const& {
+    Trie result(*this);
+    result += other;
+    return result;
+}
+
+// The rvalue overloads hand the nodes of the operand that dies over to the result
+Trie Trie::operator+(const Trie& other) && {
+    Trie result(std::move(*this));
+    result += other;
+    return result;
+}
+
+Trie Trie::operator+(Trie&& other) const& {
+    Trie result(std::move(other));
+    result += *this;
+    return result;
+}
+
+Trie Trie::operator+(Trie&& other) && {
+    // Keep the larger trie and walk the smaller one into it
+    const bool keep_other = other.nodes.size() > nodes.size();
+    Trie result(keep_other ? std::move(other) : std::move(*this));
+    result += keep_other ? *this : other;
+    return result;
+}
+
+Trie& Trie::operator+=(const Trie& other) {
+    if (this == &other || other.nodes.empty()) {
+        return *this;
+    }
+    if (nodes.empty()) {
+        newNode('\0', Node::npos);
+    }
+    if (weights.empty() && !other.weights.empty()) {
+        weights.resize(nodes.extent(), Weight{0, 0});
+    }
+    const bool weighted = !weights.empty();
+    // Walk both tries together, creating the nodes of "other" that this trie lacks on the way. A word of
+    // both keeps the larger of its two weights, so every operand order gives the same topK()
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+    std::vector<std::uint32_t> visited;
+    stack.reserve(64);
+    stack.emplace_back(root, root);
+    while (!stack.empty()) {
+        const auto [mine, theirs] = stack.back();
+        stack.pop_back();
+        const Node& source = other.nodes[theirs];
+        if (source.is_finished) {
+            nodes[mine].is_finished = true;
+            if (!other.weights.empty()) {
+                weights[mine].own = std::max(weights[mine].own, other.weights[theirs].own);
+            }
+        }
+        if (weighted) {
+            visited.push_back(mine);
+        }
+        other.forEachChild(source, [&](std::uint32_t from) {
+            const unsigned char c = static_cast<unsigned char>(other.nodes[from].data);
+            std::uint32_t to = child(mine, c);
+            if (to == Node::npos) {
+                to = newNode(static_cast<char>(c), mine);
+                addChild(mine, c, to);
+            }
+            stack.emplace_back(to, from);
+        });
+    }
+
+    // Every node was visited after its parent, so going backwards re-weighs bottom-up
+    for (auto it = visited.rbegin(); it != visited.rend(); ++it) {
+        weights[*it].subtree = subtreeWeight(*it);
+    }
+    return *this;
+}
+
+Trie Trie::operator-(const Trie& other) const& {
+    Trie result(*this);
+    result -= other;
+    return result;
+}
+
+Trie Trie::operator-(const Trie& other) && {
+    if (this == &other) {
+        return Trie();
+    }
+    Trie result(std::move(*this));
+    result -= other;
+    return result;
+}
+
+Trie& Trie::operator-=(const Trie& other) {
+    if (this == &other) {
+        return *this = Trie();
+    }
+    if (nodes.empty() || other.nodes.empty()) {
+        return *this;
+    }
+    // Walk the paths both tries share, unmarking the words of "other"
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+    std::vector<std::uint32_t> visited;
+    stack.reserve(64);
+    stack.emplace_back(root, root);
+    while (!stack.empty()) {
+        const auto [mine, theirs] = stack.back();
+        stack.pop_back();
+        visited.push_back(mine);
+        const Node& source = other.nodes[theirs];
+        if (source.is_finished && nodes[mine].is_finished) {
+            nodes[mine].is_finished = false;
+            if (!weights.empty()) {
+                weights[mine].own = 0;
+            }
+        }
+        other.forEachChild(source, [&](std::uint32_t from) {
+            const std::uint32_t to = child(mine, static_cast<unsigned char>(other.nodes[from].data));
+            if (to != Node::npos) {
+                stack.emplace_back(to, from);
+            }
+        });
+    }
+
+    // Every node was visited after its parent, so going backwards prunes and re-weighs bottom-up
+    for (auto it = visited.rbegin(); it != visited.rend(); ++it) {
+        const std::uint32_t index = *it;
+        if (index != root && !nodes[index].is_finished && !hasChildren(index)) {
+            removeChild(nodes[index].parent, static_cast<unsigned char>(nodes[index].data));
+            nodes.release(index);
+            lookup_stats::count(lookup_stats::Counter::TrieNodesPruned);
+        } else if (!weights.empty()) {
+            weights[index].subtree = subtreeWeight(index);
+        }
+    }
+    return *this;
+}
+
+bool Trie::operator()(std::string_view query) const {
+    return search(query);
+}
+
+bool Trie::operator==(const Trie& other) const {
+    // Removal prunes every node that leads to no word, so equal word sets mean equal shapes and the
+    // two tries can be compared node by node without spelling out a single word
+    const auto hasNoWords = [](const Trie& trie) {
+        return trie.nodes.empty() || (!trie.nodes[root].is_finished && !trie.hasChildren(root));
+    };
+    if (nodes.empty() || other.nodes.empty()) {
+        return hasNoWords(*this) && hasNoWords(other);
+    }
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, root);
+    while (!stack.empty()) {
+        const auto [mine, theirs] = stack.back();
+        stack.pop_back();
+        const Node& a = nodes[mine];
+        const Node& b = other.nodes[theirs];
+        if (a.is_finished != b.is_finished || a.child_count != b.child_count) {
+            return false;
+        }
+        std::uint32_t cursor_a = 0;
+        std::uint32_t cursor_b = 0;
+        for (std::uint16_t i = 0; i < a.child_count; ++i) {
+            const std::uint32_t child_a = nextChild(a, cursor_a);
+            const std::uint32_t child_b = other.nextChild(b, cursor_b);
+            if (nodes[child_a].data != other.nodes[child_b].data) {
+                return false;
+            }
+            stack.emplace_back(child_a, child_b);
+        }
+    }
+    return true;
+}
+
+bool Trie::operator!=(const Trie& other) const {
+    return !(*this == other);
+}
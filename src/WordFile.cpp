@@ -0,0 +1,51 @@
+#include "WordFile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WORD_FILE_HAVE_MMAP 1
+#endif
+
+#if defined(WORD_FILE_HAVE_MMAP)
+
+MappedFile::MappedFile(const std::string& file_name) : data(nullptr), size(0), open(false), mapped(false) {
+    const int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    open = true;
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (info.st_size == 0) {
+            mapped = true;  // Nothing to map, the empty view is the whole file
+        } else {
+            void* addr = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                ::madvise(addr, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+                data = static_cast<const char*>(addr);
+                size = static_cast<std::size_t>(info.st_size);
+                mapped = true;
+            }
+        }
+    }
+    ::close(fd);  // The mapping stays valid after the descriptor is closed
+}
+
+MappedFile::~MappedFile() {
+    if (data) {
+        ::munmap(const_cast<char*>(data), size);
+    }
+}
+
+#else
+
+// Without mmap the file is only probed here and read in chunks by forEachWordInFile
+MappedFile::MappedFile(const std::string& file_name) : data(nullptr), size(0), open(false), mapped(false) {
+    open = std::ifstream(file_name).is_open();
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
@@ -0,0 +1,670 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "BloomFilter.h"
+#include "CDNServer.h"
+#include "ConcurrentBloomFilter.h"
+#include "ConcurrentTrie.h"
+#include "FrozenTrie.h"
+#include "RadixTrie.h"
+#include "ShardedBloomFilter.h"
+#include "ShardedCDNServer.h"
+#include "Trie.h"
+#include "WordFile.h"
+
+namespace {
+
+constexpr std::size_t kBits = std::size_t{1} << 23;  // 1 MiB of bits, larger than L2 on most parts
+constexpr unsigned int kHashes = 4;
+constexpr std::size_t kKeys = 1 << 16;
+
+const std::vector<std::string>& keys() {
+    static const std::vector<std::string> words = [] {
+        std::vector<std::string> result;
+        result.reserve(kKeys);
+        for (std::size_t i = 0; i < kKeys; ++i) {
+            result.push_back("key" + std::to_string(i * 2654435761u));
+        }
+        return result;
+    }();
+    return words;
+}
+
+// Filters shared by all benchmark threads
+ConcurrentBloomFilter<kBits>& sharedConcurrentFilter() {
+    static auto filter = std::make_unique<ConcurrentBloomFilter<kBits>>(kHashes);
+    return *filter;
+}
+
+BloomFilter<kBits>& sharedLockedFilter() {
+    static auto filter = std::make_unique<BloomFilter<kBits>>(kHashes);
+    return *filter;
+}
+
+std::mutex locked_filter_mutex;
+
+// Words of "file_name" exactly as stored
+std::vector<std::string> loadWords(const std::string& file_name) {
+    std::vector<std::string> words;
+    forEachWordInFile(file_name, [&words](std::string_view word) {
+        words.emplace_back(word);
+    });
+    return words;
+}
+
+// Words of Resource/Word_DataSet_<n>.txt, n being 1 or 2. Run the benchmarks from the build directory
+const std::vector<std::string>& dataSet(int n) {
+    static const std::vector<std::string> sets[2] = {
+        loadWords("../Resource/Word_DataSet_1.txt"),
+        loadWords("../Resource/Word_DataSet_2.txt"),
+    };
+    return sets[n - 1];
+}
+
+// Bytes currently allocated from the heap, 0 where glibc's statistics are unavailable
+std::size_t heapInUse() {
+#if defined(__GLIBC__)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// "count" indices into a population of "n", index i drawn with probability proportional to 1 / (i + 1)^s,
+// the skew of real lookup traffic where a few hot keys dominate. Deterministic across runs
+std::vector<std::size_t> zipfianIndices(std::size_t count, std::size_t n, double s = 1.0) {
+    std::vector<double> cdf(n);
+    double total = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        total += 1.0 / std::pow(static_cast<double>(i + 1), s);
+        cdf[i] = total;
+    }
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    std::vector<std::size_t> indices(count);
+    for (std::size_t& index : indices) {
+        const auto it = std::lower_bound(cdf.begin(), cdf.end(), uniform(generator));
+        index = std::min(static_cast<std::size_t>(it - cdf.begin()), n - 1);
+    }
+    return indices;
+}
+
+// Zipfian queries over keys(), of which the filters and servers below hold the even-numbered half, so
+// about half of the traffic is absent
+const std::vector<std::size_t>& zipfianQueries() {
+    static const std::vector<std::size_t> queries = zipfianIndices(kKeys, kKeys);
+    return queries;
+}
+
+// Items a filter of N bits is filled with: about 10 bits per item, the usual 1% sizing, at most half of keys()
+constexpr std::size_t itemsFor(std::size_t bits) {
+    return std::min(bits / 10, kKeys / 2);
+}
+
+} // namespace
+
+// ====================== CONCURRENT BLOOM FILTER ======================
+
+// Lock-free inserts from every thread into one shared filter
+static void BM_ConcurrentBloomFilter_Add(benchmark::State& state) {
+    auto& filter = sharedConcurrentFilter();
+    const auto& words = keys();
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        filter.add(words[i++ % kKeys]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConcurrentBloomFilter_Add)->ThreadRange(1, 32)->UseRealTime();
+
+// Lock-free lookups from every thread while the filter is shared
+static void BM_ConcurrentBloomFilter_PossiblyContains(benchmark::State& state) {
+    auto& filter = sharedConcurrentFilter();
+    const auto& words = keys();
+    if (state.thread_index() == 0) {
+        for (std::size_t i = 0; i < kKeys; i += 2) {
+            filter.add(words[i]);
+        }
+    }
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter.possiblyContains(words[i++ % kKeys]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConcurrentBloomFilter_PossiblyContains)->ThreadRange(1, 32)->UseRealTime();
+
+// Baseline: the plain BloomFilter behind one mutex, which is what sharing it required before
+static void BM_MutexBloomFilter_Add(benchmark::State& state) {
+    auto& filter = sharedLockedFilter();
+    const auto& words = keys();
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(locked_filter_mutex);
+        filter.add(words[i++ % kKeys]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexBloomFilter_Add)->ThreadRange(1, 32)->UseRealTime();
+
+static void BM_MutexBloomFilter_PossiblyContains(benchmark::State& state) {
+    auto& filter = sharedLockedFilter();
+    const auto& words = keys();
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(locked_filter_mutex);
+        benchmark::DoNotOptimize(filter.possiblyContains(words[i++ % kKeys]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexBloomFilter_PossiblyContains)->ThreadRange(1, 32)->UseRealTime();
+
+// ====================== BLOOM FILTER ======================
+
+// add() on a filter of N bits with state.range(0) hash functions; the filter is reset once it has taken
+// the items it is sized for
+template <std::size_t N>
+static void BM_BloomFilterAdd(benchmark::State& state) {
+    auto filter = std::make_unique<BloomFilter<N>>(static_cast<unsigned int>(state.range(0)), nullptr);
+    const auto& words = keys();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        filter->add(words[i % kKeys]);
+        if (++i % itemsFor(N) == 0) {
+            filter->reset();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// possiblyContains() on a filter of N bits filled to its sizing, alternating present and absent keys.
+// "fpr" is the false-positive rate measured over every absent key
+template <std::size_t N>
+static void BM_BloomFilterPossiblyContains(benchmark::State& state) {
+    auto filter = std::make_unique<BloomFilter<N>>(static_cast<unsigned int>(state.range(0)), nullptr);
+    const auto& words = keys();
+    const std::size_t items = itemsFor(N);
+    for (std::size_t i = 0; i < items; ++i) {
+        filter->add(words[2 * i]);
+    }
+    std::size_t false_positives = 0;
+    for (std::size_t i = 1; i < kKeys; i += 2) {
+        false_positives += filter->possiblyContains(words[i]);
+    }
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter->possiblyContains(words[i % (2 * items)]));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["fpr"] = static_cast<double>(false_positives) / static_cast<double>(kKeys / 2);
+    state.counters["items"] = static_cast<double>(items);
+}
+
+// certainlyContains() against a CDNServer holding the same items, under Zipfian traffic. "server_calls"
+// is the share of queries that reached the server, the price of the filter's false positives
+template <std::size_t N>
+static void BM_BloomFilterCertainlyContains(benchmark::State& state) {
+    auto server = std::make_shared<CDNServer>();
+    auto filter = std::make_unique<BloomFilter<N>>(static_cast<unsigned int>(state.range(0)), server);
+    const auto& words = keys();
+    for (std::size_t i = 0; i < itemsFor(N); ++i) {
+        filter->add(words[2 * i]);
+    }
+    const auto& queries = zipfianQueries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter->certainlyContains(words[queries[i++ % kKeys]]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["server_calls"] =
+        static_cast<double>(server->getUsageCount()) / static_cast<double>(state.iterations());
+}
+
+#define BLOOM_FILTER_BENCHMARKS(N)                                                           \
+    BENCHMARK(BM_BloomFilterAdd<N>)->Arg(2)->Arg(4)->Arg(8);                                \
+    BENCHMARK(BM_BloomFilterPossiblyContains<N>)->Arg(2)->Arg(4)->Arg(8);                   \
+    BENCHMARK(BM_BloomFilterCertainlyContains<N>)->Arg(2)->Arg(4)->Arg(8)
+
+BLOOM_FILTER_BENCHMARKS(8192);            // 1 KiB, fits L1
+BLOOM_FILTER_BENCHMARKS(81920);           // The default-sized filter, 10 KiB
+BLOOM_FILTER_BENCHMARKS(std::size_t{1} << 16);
+BLOOM_FILTER_BENCHMARKS(std::size_t{1} << 20);
+BLOOM_FILTER_BENCHMARKS(kBits);           // Larger than L2
+
+// ====================== CDN SERVER ======================
+
+// checkWord() on the server holding data set state.range(0), alternating its words and the other set's
+static void BM_CDNServerCheckWord(benchmark::State& state) {
+    const int set = static_cast<int>(state.range(0));
+    const auto& words = dataSet(set);
+    const auto& others = dataSet(3 - set);
+    CDNServer server;
+    for (const std::string& word : words) {
+        server.addWord(word);
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(server.checkWord(words[i % words.size()]));
+        benchmark::DoNotOptimize(server.checkWord(others[i % others.size()]));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.counters["allocated_bytes"] = static_cast<double>(server.memoryUsage().allocated_bytes);
+}
+BENCHMARK(BM_CDNServerCheckWord)->Arg(1)->Arg(2);
+
+// Zipfian checkWord() over keys(), half of which the server holds
+static void BM_CDNServerCheckWordZipfian(benchmark::State& state) {
+    CDNServer server;
+    const auto& words = keys();
+    for (std::size_t i = 0; i < kKeys; i += 2) {
+        server.addWord(words[i]);
+    }
+    const auto& queries = zipfianQueries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(server.checkWord(words[queries[i++ % kKeys]]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CDNServerCheckWordZipfian);
+
+// Single-threaded checkWord() of the open-addressing shards against the same data sets as CDNServer
+static void BM_ShardedCDNServerCheckWord(benchmark::State& state) {
+    const int set = static_cast<int>(state.range(0));
+    const auto& words = dataSet(set);
+    const auto& others = dataSet(3 - set);
+    ShardedCDNServer server;
+    for (const std::string& word : words) {
+        server.addWord(word);
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(server.checkWord(words[i % words.size()]));
+        benchmark::DoNotOptimize(server.checkWord(others[i % others.size()]));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.counters["allocated_bytes"] = static_cast<double>(server.memoryUsage().allocated_bytes);
+}
+BENCHMARK(BM_ShardedCDNServerCheckWord)->Arg(1)->Arg(2);
+
+namespace {
+
+// keys(), half of them stored, in servers shared by the threads of a benchmark
+ShardedCDNServer& sharedShardedServer() {
+    static ShardedCDNServer server;
+    static std::once_flag filled;
+    std::call_once(filled, [] {
+        for (std::size_t i = 0; i < kKeys; i += 2) {
+            server.addWord(keys()[i]);
+        }
+    });
+    return server;
+}
+
+CDNServer& sharedLockedServer() {
+    static CDNServer server;
+    static std::once_flag filled;
+    std::call_once(filled, [] {
+        for (std::size_t i = 0; i < kKeys; i += 2) {
+            server.addWord(keys()[i]);
+        }
+    });
+    return server;
+}
+std::mutex locked_server_mutex;
+
+} // namespace
+
+// Zipfian checkWord() from every thread on the sharded server
+static void BM_ShardedCDNServerConcurrent(benchmark::State& state) {
+    auto& server = sharedShardedServer();
+    const auto& words = keys();
+    const auto& queries = zipfianQueries();
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(server.checkWord(words[queries[i++ % kKeys]]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShardedCDNServerConcurrent)->ThreadRange(1, 8)->UseRealTime();
+
+// Baseline: the same checks on a CDNServer that every thread locks
+static void BM_MutexCDNServerConcurrent(benchmark::State& state) {
+    auto& server = sharedLockedServer();
+    const auto& words = keys();
+    const auto& queries = zipfianQueries();
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(locked_server_mutex);
+        benchmark::DoNotOptimize(server.checkWord(words[queries[i++ % kKeys]]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexCDNServerConcurrent)->ThreadRange(1, 8)->UseRealTime();
+
+// BM_BloomFilterCertainlyContains<kBits> with the bits split over the filter shards of a ShardedCDNServer
+static void BM_ShardedBloomFilterCertainlyContains(benchmark::State& state) {
+    ShardedBloomFilter<kBits / ShardedCDNServer::default_shards> filter(kHashes);
+    const auto& words = keys();
+    for (std::size_t i = 0; i < itemsFor(kBits); ++i) {
+        filter.add(words[2 * i]);
+    }
+    const auto& queries = zipfianQueries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter.certainlyContains(words[queries[i++ % kKeys]]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["server_calls"] =
+        static_cast<double>(filter.backend()->getUsageCount()) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_ShardedBloomFilterCertainlyContains);
+
+// ====================== TRIE ======================
+
+// Builds a TrieType from data set state.range(0), reporting the heap it occupies, then times lookups
+// of every word of the set; the other data set supplies the mostly absent queries
+template <typename TrieType>
+static void BM_TrieSearch(benchmark::State& state) {
+    const int set = static_cast<int>(state.range(0));
+    const auto& words = dataSet(set);
+    const auto& others = dataSet(3 - set);
+
+    const std::size_t heap_before = heapInUse();
+    auto trie = std::make_unique<TrieType>();
+    for (const std::string& word : words) {
+        trie->insert(word);
+    }
+    const std::size_t heap_bytes = heapInUse() - heap_before;
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(trie->search(words[i % words.size()]));
+        benchmark::DoNotOptimize(trie->search(others[i % others.size()]));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.counters["heap_bytes"] = static_cast<double>(heap_bytes);
+    if constexpr (requires { trie->memoryUsage(); }) {
+        state.counters["allocated_bytes"] = static_cast<double>(trie->memoryUsage().allocated_bytes);
+    }
+    state.counters["words"] = static_cast<double>(words.size());
+}
+BENCHMARK(BM_TrieSearch<Trie>)->Arg(1)->Arg(2);
+BENCHMARK(BM_TrieSearch<RadixTrie>)->Arg(1)->Arg(2);
+
+// Same lookups on the frozen form of the Trie, reporting the heap held by the double array alone
+static void BM_FrozenTrieSearch(benchmark::State& state) {
+    const int set = static_cast<int>(state.range(0));
+    const auto& words = dataSet(set);
+    const auto& others = dataSet(3 - set);
+
+    Trie trie;
+    for (const std::string& word : words) {
+        trie.insert(word);
+    }
+    const std::size_t heap_before = heapInUse();
+    const FrozenTrie frozen = trie.freeze();
+    const std::size_t heap_bytes = heapInUse() - heap_before;
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(frozen.search(words[i % words.size()]));
+        benchmark::DoNotOptimize(frozen.search(others[i % others.size()]));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.counters["heap_bytes"] = static_cast<double>(heap_bytes);
+    state.counters["allocated_bytes"] = static_cast<double>(frozen.memoryUsage().allocated_bytes);
+    state.counters["words"] = static_cast<double>(frozen.size());
+}
+BENCHMARK(BM_FrozenTrieSearch)->Arg(1)->Arg(2);
+
+// Inserting every word of data set state.range(0) into a fresh Trie
+static void BM_TrieInsert(benchmark::State& state) {
+    const auto& words = dataSet(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        Trie trie;
+        for (const std::string& word : words) {
+            trie.insert(word);
+        }
+        benchmark::DoNotOptimize(trie.startsWith("a"));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(words.size()));
+}
+BENCHMARK(BM_TrieInsert)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// startsWith() with the first half of every word of the set and of the other set
+static void BM_TrieStartsWith(benchmark::State& state) {
+    const int set = static_cast<int>(state.range(0));
+    const auto& words = dataSet(set);
+    const auto& others = dataSet(3 - set);
+    const Trie trie = Trie::fromWords(words);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::string& word = words[i % words.size()];
+        const std::string& other = others[i % others.size()];
+        benchmark::DoNotOptimize(trie.startsWith(std::string_view(word).substr(0, (word.size() + 1) / 2)));
+        benchmark::DoNotOptimize(trie.startsWith(std::string_view(other).substr(0, (other.size() + 1) / 2)));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_TrieStartsWith)->Arg(1)->Arg(2);
+
+// search() under Zipfian traffic over keys(), half of which the Trie holds
+static void BM_TrieSearchZipfian(benchmark::State& state) {
+    const auto& words = keys();
+    Trie trie;
+    for (std::size_t i = 0; i < kKeys; i += 2) {
+        trie.insert(words[i]);
+    }
+    const auto& queries = zipfianQueries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(trie.search(words[queries[i++ % kKeys]]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrieSearchZipfian);
+
+// Removing every word of the set one by one, pruning as it goes; the copy to remove from is not timed
+static void BM_TrieRemove(benchmark::State& state) {
+    const auto& words = dataSet(static_cast<int>(state.range(0)));
+    const Trie full = Trie::fromWords(words);
+    for (auto _ : state) {
+        state.PauseTiming();
+        Trie trie(full);
+        state.ResumeTiming();
+        for (const std::string& word : words) {
+            trie.remove(word);
+        }
+        benchmark::DoNotOptimize(trie.startsWith("a"));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(words.size()));
+}
+BENCHMARK(BM_TrieRemove)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// A full bfs() or dfs() through std::function, counting the nodes
+template <bool BreadthFirst>
+static void BM_TrieTraversal(benchmark::State& state) {
+    Trie trie = Trie::fromWords(dataSet(static_cast<int>(state.range(0))));
+    std::size_t visited = 0;
+    for (auto _ : state) {
+        visited = 0;
+        const auto count = [&visited](Trie::Node*&) { ++visited; };
+        if constexpr (BreadthFirst) {
+            trie.bfs(count);
+        } else {
+            trie.dfs(count);
+        }
+        benchmark::DoNotOptimize(visited);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(visited));
+}
+BENCHMARK(BM_TrieTraversal<true>)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TrieTraversal<false>)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// Union and difference of the two data sets
+static void BM_TrieUnion(benchmark::State& state) {
+    const Trie first = Trie::fromWords(dataSet(1));
+    const Trie second = Trie::fromWords(dataSet(2));
+    for (auto _ : state) {
+        const Trie result = first + second;
+        benchmark::DoNotOptimize(result.startsWith("a"));
+    }
+}
+BENCHMARK(BM_TrieUnion)->Unit(benchmark::kMicrosecond);
+
+static void BM_TrieDifference(benchmark::State& state) {
+    const Trie first = Trie::fromWords(dataSet(1));
+    const Trie second = Trie::fromWords(dataSet(2));
+    for (auto _ : state) {
+        const Trie result = first - second;
+        benchmark::DoNotOptimize(result.startsWith("a"));
+    }
+}
+BENCHMARK(BM_TrieDifference)->Unit(benchmark::kMicrosecond);
+
+// Dumps the Trie of data set state.range(0) to memory with operator<< or with the binary save(),
+// reporting the bytes written
+template <bool Binary>
+static void BM_TrieSave(benchmark::State& state) {
+    const Trie trie = Trie::fromWords(dataSet(static_cast<int>(state.range(0))));
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        std::ostringstream stream;
+        if constexpr (Binary) {
+            trie.save(stream);
+        } else {
+            stream << trie;
+        }
+        bytes = stream.view().size();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.counters["bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_TrieSave<false>)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TrieSave<true>)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// Rebuilds the same Trie from a dump in memory, with operator>> or with the binary load()
+template <bool Binary>
+static void BM_TrieLoad(benchmark::State& state) {
+    const Trie trie = Trie::fromWords(dataSet(static_cast<int>(state.range(0))));
+    std::ostringstream dump;
+    if constexpr (Binary) {
+        trie.save(dump);
+    } else {
+        dump << trie;
+    }
+    const std::string bytes = dump.str();
+    for (auto _ : state) {
+        std::istringstream stream(bytes);
+        if constexpr (Binary) {
+            Trie loaded = Trie::load(stream);
+            benchmark::DoNotOptimize(loaded.startsWith("a"));
+        } else {
+            Trie loaded;
+            stream >> loaded;
+            benchmark::DoNotOptimize(loaded.startsWith("a"));
+        }
+    }
+}
+BENCHMARK(BM_TrieLoad<false>)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TrieLoad<true>)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+namespace {
+
+// Data set 1 shared by every thread, as a lock-free ConcurrentTrie and as a Trie behind one mutex
+ConcurrentTrie& sharedConcurrentTrie() {
+    static ConcurrentTrie trie(Trie::fromWords(dataSet(1)));
+    return trie;
+}
+
+Trie& sharedLockedTrie() {
+    static Trie trie = Trie::fromWords(dataSet(1));
+    return trie;
+}
+std::mutex locked_trie_mutex;
+
+} // namespace
+
+// Lookups from every thread while thread 0 also keeps inserting and removing a word
+static void BM_ConcurrentTrieSearch(benchmark::State& state) {
+    auto& trie = sharedConcurrentTrie();
+    const auto& words = dataSet(1);
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && i % 64 == 0) {
+            trie.insert("concurrent-update");
+            trie.remove("concurrent-update");
+        }
+        benchmark::DoNotOptimize(trie.search(words[i++ % words.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConcurrentTrieSearch)->ThreadRange(1, 8)->UseRealTime();
+
+// Baseline: the same lookups and updates on a Trie that every thread locks
+static void BM_MutexTrieSearch(benchmark::State& state) {
+    auto& trie = sharedLockedTrie();
+    const auto& words = dataSet(1);
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(locked_trie_mutex);
+        if (state.thread_index() == 0 && i % 64 == 0) {
+            trie.insert("concurrent-update");
+            trie.remove("concurrent-update");
+        }
+        benchmark::DoNotOptimize(trie.search(words[i++ % words.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexTrieSearch)->ThreadRange(1, 8)->UseRealTime();
+
+// Dictionary-sized input for the bulk build: lower-case words spread over every first letter
+const std::vector<std::string>& dictionaryWords() {
+    static const std::vector<std::string> words = [] {
+        std::vector<std::string> result;
+        result.reserve(kKeys * 4);
+        for (std::size_t i = 0; i < kKeys * 4; ++i) {
+            std::string word;
+            for (std::uint64_t n = (i + 1) * 0x9E3779B97F4A7C15ull; word.size() < 4 || n % 3; n /= 26) {
+                word.push_back(static_cast<char>('a' + n % 26));
+            }
+            result.push_back(word);
+        }
+        return result;
+    }();
+    return words;
+}
+
+// Trie::fromWords with state.range(0) threads; one thread is plain insertion
+static void BM_TrieFromWords(benchmark::State& state) {
+    const auto& words = dictionaryWords();
+    const unsigned int threads = static_cast<unsigned int>(state.range(0));
+    for (auto _ : state) {
+        Trie trie = Trie::fromWords(words, threads);
+        benchmark::DoNotOptimize(trie.startsWith("a"));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(words.size()));
+}
+BENCHMARK(BM_TrieFromWords)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
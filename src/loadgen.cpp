@@ -0,0 +1,343 @@
+// End-to-end load generator: replays a configurable mix of word hits, word misses and prefix queries
+// from several threads against one shared BloomFilter + Trie + CDNServer deployment, and reports
+// throughput, latency percentiles and how many backend calls the local tiers saved.
+//
+//   ./loadgen --threads=8 --queries=200000 --hits=0.6 --misses=0.3 --prefixes=0.1 --shards=16
+//
+// Run it from the build directory so that the default word file is found.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "BloomFilter.h"
+#include "CDNServer.h"
+#include "LookupPipeline.h"
+#include "LookupStats.h" // Histogram
+#include "ShardedBloomFilter.h"
+#include "ShardedCDNServer.h"
+#include "Trie.h"
+#include "WordFile.h"
+
+namespace {
+
+constexpr std::size_t kFilterBits = std::size_t{1} << 20;
+// Bits of each filter shard, so that the default shard count adds up to one kFilterBits filter
+constexpr std::size_t kShardBits = kFilterBits / ShardedCDNServer::default_shards;
+
+struct Options {
+    std::string words = "../Resource/Word_DataSet_1.txt";
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t queries = 200000;   // Per thread
+    double hits = 0.6;              // Shares of the query mix, normalized to sum to one
+    double misses = 0.3;
+    double prefixes = 0.1;
+    double zipf = 1.0;              // Skew of the word popularity
+    double local = 0.2;             // Fraction of the words, most popular first, held by the local Trie
+    unsigned int hashes = 7;
+    std::size_t shards = 0;         // 0 for one CDNServer behind a mutex, otherwise ShardedCDNServer shards
+};
+
+void usage() {
+    const Options defaults;
+    std::cerr << "usage: loadgen [--option=value ...]\n"
+              << "  --words=FILE     comma-separated word file (" << defaults.words << ")\n"
+              << "  --threads=N      client threads (" << defaults.threads << ")\n"
+              << "  --queries=N      queries per thread (" << defaults.queries << ")\n"
+              << "  --hits=X         share of queries for stored words (" << defaults.hits << ")\n"
+              << "  --misses=X       share of queries for absent words (" << defaults.misses << ")\n"
+              << "  --prefixes=X     share of prefix queries (" << defaults.prefixes << ")\n"
+              << "  --zipf=S         Zipf exponent of word popularity, 0 for uniform (" << defaults.zipf << ")\n"
+              << "  --local=X        fraction of words, hottest first, in the local Trie (" << defaults.local << ")\n"
+              << "  --hashes=N       hash functions of the Bloom filters (" << defaults.hashes << ")\n"
+              << "  --shards=N       ShardedCDNServer and ShardedBloomFilter shards, 0 for a locked CDNServer ("
+              << defaults.shards << ")\n";
+}
+
+// Parses "--name=value" arguments, throwing std::invalid_argument on anything else
+Options parse(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const std::size_t equals = arg.find('=');
+        if (!arg.starts_with("--") || equals == std::string_view::npos) {
+            throw std::invalid_argument("loadgen: unexpected argument \"" + std::string(arg) + "\"");
+        }
+        const std::string_view name = arg.substr(2, equals - 2);
+        const std::string value(arg.substr(equals + 1));
+        if (name == "words") {
+            options.words = value;
+        } else if (name == "threads") {
+            options.threads = static_cast<unsigned int>(std::stoul(value));
+        } else if (name == "queries") {
+            options.queries = std::stoull(value);
+        } else if (name == "hits") {
+            options.hits = std::stod(value);
+        } else if (name == "misses") {
+            options.misses = std::stod(value);
+        } else if (name == "prefixes") {
+            options.prefixes = std::stod(value);
+        } else if (name == "zipf") {
+            options.zipf = std::stod(value);
+        } else if (name == "local") {
+            options.local = std::stod(value);
+        } else if (name == "hashes") {
+            options.hashes = static_cast<unsigned int>(std::stoul(value));
+        } else if (name == "shards") {
+            options.shards = std::stoull(value);
+        } else {
+            throw std::invalid_argument("loadgen: unknown option \"--" + std::string(name) + "\"");
+        }
+    }
+    if (options.threads == 0 || options.hashes == 0 || options.hits < 0 || options.misses < 0 ||
+        options.prefixes < 0 || options.hits + options.misses + options.prefixes <= 0) {
+        throw std::invalid_argument("loadgen: thread and hash counts must be positive, shares non-negative");
+    }
+    return options;
+}
+
+// CDNServer behind one mutex, as CDNServer itself must not be called from several threads at once
+class LockedServer : public LookupBackend {
+public:
+    void addWord(std::string_view word) override {
+        const std::lock_guard lock(mutex);
+        server.addWord(word);
+    }
+    void removeWord(std::string_view word) override {
+        const std::lock_guard lock(mutex);
+        server.removeWord(word);
+    }
+    bool checkWord(std::string_view word) override {
+        const std::lock_guard lock(mutex);
+        return server.checkWord(word);
+    }
+    std::size_t usageCount() {
+        const std::lock_guard lock(mutex);
+        return server.getUsageCount();
+    }
+
+private:
+    std::mutex mutex;
+    CDNServer server;
+};
+
+enum class Kind { Hit, Miss, Prefix };
+
+struct Query {
+    Kind kind;
+    std::string text;
+};
+
+// Queries of one thread, drawn before the clock starts: words by Zipfian popularity, misses as words
+// with a suffix no stored word has, prefixes as the first half of a popular word
+std::vector<Query> makeQueries(const Options& options, const std::vector<std::string>& words,
+                               const std::vector<double>& popularity, unsigned int thread) {
+    std::mt19937_64 generator(0x5eed + thread);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double total_share = options.hits + options.misses + options.prefixes;
+    const auto pick = [&] {
+        const auto it = std::lower_bound(popularity.begin(), popularity.end(), uniform(generator) * popularity.back());
+        return std::min(static_cast<std::size_t>(it - popularity.begin()), words.size() - 1);
+    };
+
+    std::vector<Query> queries;
+    queries.reserve(options.queries);
+    for (std::size_t i = 0; i < options.queries; ++i) {
+        const double kind = uniform(generator) * total_share;
+        const std::string& word = words[pick()];
+        if (kind < options.hits) {
+            queries.push_back(Query{Kind::Hit, word});
+        } else if (kind < options.hits + options.misses) {
+            queries.push_back(Query{Kind::Miss, word + "#" + std::to_string(i)});
+        } else {
+            queries.push_back(Query{Kind::Prefix, word.substr(0, (word.size() + 1) / 2)});
+        }
+    }
+    return queries;
+}
+
+// What one client thread measured
+struct ThreadResult {
+    lookup_stats::Histogram latency;
+    std::vector<LookupPipeline::StageStats> word_stages;
+    std::vector<LookupPipeline::StageStats> prefix_stages;
+    std::size_t found = 0;
+};
+
+void addStages(std::vector<LookupPipeline::StageStats>& total, const std::vector<LookupPipeline::StageStats>& stages) {
+    if (total.empty()) {
+        total = stages;
+        return;
+    }
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        total[i].present += stages[i].present;
+        total[i].absent += stages[i].absent;
+        total[i].passed += stages[i].passed;
+        total[i].time += stages[i].time;
+    }
+}
+
+void printStages(const char* title, const std::vector<LookupPipeline::StageStats>& stages) {
+    std::cout << title << "\n";
+    for (const auto& stage : stages) {
+        const double calls = static_cast<double>(std::max<std::size_t>(1, stage.calls()));
+        std::cout << "  " << std::left << std::setw(14) << stage.name << std::right
+                  << std::setw(10) << stage.calls() << " calls, "
+                  << std::setw(10) << stage.present << " present, "
+                  << std::setw(10) << stage.absent << " absent, "
+                  << std::setw(10) << stage.passed << " passed on, "
+                  << std::setw(7) << std::fixed << std::setprecision(1)
+                  << static_cast<double>(stage.time.count()) / calls << " ns avg\n";
+    }
+}
+
+int run(const Options& options) {
+    std::vector<std::string> words;
+    if (!forEachWordInFile(options.words, [&words](std::string_view word) { words.emplace_back(word); }) ||
+        words.empty()) {
+        throw std::runtime_error("loadgen: no words in \"" + options.words + "\"");
+    }
+
+    // Popularity follows the order of the file, word i weighing 1 / (i + 1)^s
+    std::vector<double> popularity(words.size());
+    double total = 0.0;
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        total += 1.0 / std::pow(static_cast<double>(i + 1), options.zipf);
+        popularity[i] = total;
+    }
+
+    // The deployment: the server and the word filter hold every word, the local Trie the hottest ones.
+    // Either one filter fronts one locked CDNServer, or a filter shard fronts each ShardedCDNServer shard
+    std::shared_ptr<LockedServer> server;
+    std::unique_ptr<BloomFilter<kFilterBits>> filter;
+    std::shared_ptr<ShardedCDNServer> sharded_server;
+    std::unique_ptr<ShardedBloomFilter<kShardBits>> sharded_filter;
+    if (options.shards) {
+        sharded_server = std::make_shared<ShardedCDNServer>(options.shards);
+        sharded_filter = std::make_unique<ShardedBloomFilter<kShardBits>>(options.hashes, sharded_server);
+    } else {
+        server = std::make_shared<LockedServer>();
+        filter = std::make_unique<BloomFilter<kFilterBits>>(options.hashes, server);
+    }
+    auto prefix_filter = std::make_unique<BloomFilter<kFilterBits>>(options.hashes, nullptr);
+    Trie local;
+    Trie all;
+    const auto local_words = static_cast<std::size_t>(std::ceil(options.local * static_cast<double>(words.size())));
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        if (sharded_filter) {
+            sharded_filter->add(words[i]);
+        } else {
+            filter->add(words[i]);
+        }
+        LookupPipeline::addPrefixes(*prefix_filter, words[i]);
+        all.insert(words[i]);
+        if (i < local_words) {
+            local.insert(words[i]);
+        }
+    }
+
+    std::vector<std::vector<Query>> queries(options.threads);
+    for (unsigned int t = 0; t < options.threads; ++t) {
+        queries[t] = makeQueries(options, words, popularity, t);
+    }
+
+    // Every thread owns its pipelines, whose counters are not shared; the structures behind them are.
+    // std::jthread joins the started clients should launching one throw, and an exception thrown by a
+    // client is kept in its slot and rethrown once every client has finished
+    std::vector<ThreadResult> results(options.threads);
+    std::vector<std::exception_ptr> errors(options.threads);
+    std::vector<std::jthread> clients;
+    clients.reserve(options.threads);
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned int t = 0; t < options.threads; ++t) {
+        clients.emplace_back([&, t] {
+            try {
+                LookupPipeline word_pipeline = sharded_filter ? LookupPipeline::words(*sharded_filter, local, sharded_server)
+                                                              : LookupPipeline::words(*filter, local, server);
+                LookupPipeline prefix_pipeline = LookupPipeline::prefixes(*prefix_filter, all);
+                ThreadResult& result = results[t];
+                for (const Query& query : queries[t]) {
+                    const auto begin = std::chrono::steady_clock::now();
+                    const bool found = query.kind == Kind::Prefix ? prefix_pipeline.contains(query.text)
+                                                                  : word_pipeline.contains(query.text);
+                    const auto ns = std::chrono::nanoseconds(std::chrono::steady_clock::now() - begin).count();
+                    ++result.latency.counts[lookup_stats::Histogram::bucketOf(static_cast<std::uint64_t>(ns))];
+                    result.found += found;
+                }
+                result.word_stages = word_pipeline.stats();
+                result.prefix_stages = prefix_pipeline.stats();
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    lookup_stats::Histogram latency;
+    std::vector<LookupPipeline::StageStats> word_stages;
+    std::vector<LookupPipeline::StageStats> prefix_stages;
+    std::size_t found = 0;
+    for (const ThreadResult& result : results) {
+        for (std::size_t b = 0; b < latency.counts.size(); ++b) {
+            latency.counts[b] += result.latency.counts[b];
+        }
+        addStages(word_stages, result.word_stages);
+        addStages(prefix_stages, result.prefix_stages);
+        found += result.found;
+    }
+
+    // Only word queries could reach the backend, prefix queries have no remote stage here
+    const std::size_t total_queries = static_cast<std::size_t>(options.threads) * options.queries;
+    const std::size_t word_queries = word_stages.front().calls();
+    const std::size_t backend_calls = sharded_server ? sharded_server->getUsageCount() : server->usageCount();
+    std::cout << words.size() << " words, " << local_words << " of them local; " << options.threads
+              << " threads x " << options.queries << " queries; "
+              << (sharded_server ? std::to_string(sharded_server->shardCount()) + " server shards" : "one locked server")
+              << "\n"
+              << std::fixed << std::setprecision(3) << "elapsed " << seconds << " s, "
+              << std::setprecision(2) << static_cast<double>(total_queries) / seconds / 1e6 << " M queries/s, "
+              << found << " found\n"
+              << "latency p50 " << latency.percentile(0.5) << " ns, p99 " << latency.percentile(0.99)
+              << " ns, p999 " << latency.percentile(0.999) << " ns\n"
+              << "backend calls " << backend_calls << " (" << std::setprecision(2)
+              << 100.0 * static_cast<double>(backend_calls) / static_cast<double>(std::max<std::size_t>(1, word_queries))
+              << "% of word queries), " << word_queries - backend_calls << " avoided\n";
+    printStages("word pipeline", word_stages);
+    printStages("prefix pipeline", prefix_stages);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        return run(parse(argc, argv));
+    } catch (const std::invalid_argument& error) {
+        std::cerr << error.what() << "\n";
+        usage();
+        return 2;
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+}
@@ -1,12 +1,37 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include "BlockedBloomFilter.h"
 #include "BloomFilter.h"
+#include "CachedBackend.h"
+#include "ConcurrentBloomFilter.h"
+#include "ConcurrentTrie.h"
+#include "CountingBloomFilter.h"
+#include "DynamicBloomFilter.h"
+#include "FrozenTrie.h"
+#include "LookupPipeline.h"
+#include "LookupStats.h"
+#include "MappedBloomFilter.h"
+#include "RadixTrie.h"
+#include "ShardedBloomFilter.h"
+#include "ShardedCDNServer.h"
 #include "Trie.h"
+#include "WordFile.h"
 
 // ====================== BLOOM FILTER TESTS ======================
 
@@ -111,6 +136,53 @@ TEST(BloomFilterTest, UnionOperator) {
 	EXPECT_TRUE(result.possiblyContains("only_in_filter2"));
 }
 
+// Test that operator& and operator| leave their operands alone and that &=, |= combine in place
+TEST(BloomFilterTest, CompoundAssignmentOperators) {
+	BloomFilter<1024> filter1(3);
+	filter1.add("only_in_filter1");
+	BloomFilter<1024> filter2(3);
+	filter2.add("only_in_filter2");
+
+	BloomFilter<1024> combined = filter1 | filter2;
+	EXPECT_TRUE(combined.possiblyContains("only_in_filter2"));
+	EXPECT_FALSE(filter1.possiblyContains("only_in_filter2"));
+	BloomFilter<1024> empty = filter1 & filter2;
+	EXPECT_FALSE(empty.possiblyContains("only_in_filter1"));
+	EXPECT_TRUE(filter1.possiblyContains("only_in_filter1"));
+
+	filter1 |= filter2;
+	EXPECT_TRUE(filter1.possiblyContains("only_in_filter2"));
+	filter1 &= filter2;
+	EXPECT_FALSE(filter1.possiblyContains("only_in_filter1"));
+	EXPECT_TRUE(filter1.possiblyContains("only_in_filter2"));
+}
+
+// Test the n-way union against chained operator|
+TEST(BloomFilterTest, MergeManyFilters) {
+	std::vector<std::unique_ptr<BloomFilter<1 << 16>>> shards;
+	std::vector<const BloomFilter<1 << 16>*> views;
+	auto chained = std::make_unique<BloomFilter<1 << 16>>(4);
+	for (int s = 0; s < 12; ++s) {
+		shards.push_back(std::make_unique<BloomFilter<1 << 16>>(4));
+		for (int i = 0; i < 100; ++i) {
+			shards.back()->add("shard" + std::to_string(s) + "_" + std::to_string(i));
+		}
+		*chained |= *shards.back();
+		views.push_back(shards.back().get());
+	}
+
+	auto merged = std::make_unique<BloomFilter<1 << 16>>(4);
+	merged->merge(views);
+	for (int i = 0; i < 2000; ++i) {
+		const std::string word = "shard" + std::to_string(i % 20) + "_" + std::to_string(i / 20);
+		EXPECT_EQ(merged->possiblyContains(word), chained->possiblyContains(word)) << word;
+	}
+
+	BloomFilter<1 << 16> other_hashes(3);
+	views.push_back(&other_hashes);
+	EXPECT_THROW(merged->merge(views), std::invalid_argument);
+}
+
 // Test operator() (functional operator)
 TEST(BloomFilterTest, FunctionalOperator) {
 	BloomFilter<1024> filter(3);
@@ -149,6 +221,776 @@ TEST(BloomFilterTest, CertainlyContains) {
 	EXPECT_FALSE(filter.certainlyContains("definitely_not_present"));
 }
 
+// Test the legacy seeded hashing scheme stays available
+TEST(BloomFilterTest, SeededHashScheme) {
+	BloomFilter<1024> filter(3, HashScheme::Seeded);
+	filter.add("test");
+
+	EXPECT_EQ(filter.hashScheme(), HashScheme::Seeded);
+	EXPECT_TRUE(filter.possiblyContains("test"));
+	EXPECT_TRUE(filter.certainlyContains("test"));
+	EXPECT_FALSE(filter.certainlyContains("not_added"));
+}
+
+// Test that the double-hashing scheme is the default and derives stable positions
+TEST(BloomFilterTest, DoubleHashScheme) {
+	BloomFilter<1024> filter(5);
+	EXPECT_EQ(filter.hashScheme(), HashScheme::DoubleHashing);
+
+	for (int i = 0; i < 100; ++i) {
+		filter.add("word" + std::to_string(i));
+	}
+	for (int i = 0; i < 100; ++i) {
+		EXPECT_TRUE(filter.possiblyContains("word" + std::to_string(i)));
+	}
+
+	// The same key always hashes to the same 128-bit value
+	Hash128 a = hash128("stable");
+	Hash128 b = hash128(std::string("stable"));
+	EXPECT_EQ(a.h1, b.h1);
+	EXPECT_EQ(a.h2, b.h2);
+	EXPECT_NE(hash128("stable").h1, hash128("stablf").h1);
+}
+
+// Test that filters using different hash schemes cannot be combined
+TEST(BloomFilterTest, IncompatibleSchemes) {
+	BloomFilter<1024> filter1(3, HashScheme::Seeded);
+	BloomFilter<1024> filter2(3, HashScheme::DoubleHashing);
+	BloomFilter<1024> filter3(4, HashScheme::Seeded);
+
+	EXPECT_THROW(filter1 | filter2, std::invalid_argument);
+	EXPECT_THROW(filter1 & filter3, std::invalid_argument);
+}
+
+// Test that batch queries give exactly the scalar answers
+TEST(BloomFilterTest, PossiblyContainsBatch) {
+	for (HashScheme scheme : {HashScheme::DoubleHashing, HashScheme::Seeded}) {
+		BloomFilter<2048> filter(4, scheme);
+		std::vector<std::string> words;
+		for (int i = 0; i < 300; ++i) {
+			words.push_back("key" + std::to_string(i));
+			if (i % 2 == 0) {
+				filter.add(words.back());
+			}
+		}
+		std::vector<std::string_view> views(words.begin(), words.end());
+
+		std::vector<bool> answers = filter.possiblyContainsBatch(views);
+		ASSERT_EQ(answers.size(), words.size());
+		for (std::size_t i = 0; i < words.size(); ++i) {
+			EXPECT_EQ(answers[i], filter.possiblyContains(words[i]));
+			if (i % 2 == 0) {
+				EXPECT_TRUE(answers[i]);
+			}
+		}
+	}
+
+	BloomFilter<1024> empty(3);
+	EXPECT_TRUE(empty.possiblyContainsBatch({}).empty());
+}
+
+// Test lookups through std::string_view and C strings
+TEST(BloomFilterTest, StringViewLookups) {
+	BloomFilter<1024> filter(3);
+	filter.add("needle");
+
+	const std::string haystack = "hay needle stack";
+	std::string_view needle = std::string_view(haystack).substr(4, 6);
+	EXPECT_TRUE(filter.possiblyContains(needle));
+	EXPECT_TRUE(filter.certainlyContains(needle));
+	EXPECT_TRUE(filter(needle));
+	EXPECT_FALSE(filter.certainlyContains(std::string_view(haystack).substr(0, 3)));
+
+	const char* c_string = "needle";
+	EXPECT_TRUE(filter.possiblyContains(c_string));
+	EXPECT_TRUE(filter.certainlyContains(c_string));
+
+	// A hash computed by the caller gives the same answers, under either scheme
+	BloomFilter<1024> seeded(3, HashScheme::Seeded);
+	seeded.add("needle");
+	for (const std::string_view word : {"needle", "hay", "stack"}) {
+		EXPECT_EQ(filter.possiblyContains(word, hash128(word)), filter.possiblyContains(word));
+		EXPECT_EQ(seeded.possiblyContains(word, hash128(word)), seeded.possiblyContains(word));
+	}
+}
+
+// Test the memory-mapped file loader, with and without populating the server
+TEST(BloomFilterTest, AddFileMapped) {
+	std::ofstream file("temp_mapped_words.txt");
+	file << "alpha, beta,\ngamma, delta";
+	file.close();
+
+	BloomFilter<1024> filter(3);
+	EXPECT_EQ(filter.addFile("temp_mapped_words.txt"), 4u);
+	for (const char* word : {"alpha", "beta", "gamma", "delta"}) {
+		EXPECT_TRUE(filter.possiblyContains(word));
+		EXPECT_TRUE(filter.certainlyContains(word));
+	}
+
+	BloomFilter<1024> filter_only(3);
+	EXPECT_EQ(filter_only.addFile("temp_mapped_words.txt", false), 4u);
+	EXPECT_TRUE(filter_only.possiblyContains("gamma"));
+	EXPECT_FALSE(filter_only.certainlyContains("gamma"));
+
+	EXPECT_THROW(filter.addFile("no_such_file.txt"), std::runtime_error);
+	std::remove("temp_mapped_words.txt");
+}
+
+// Test that chunked streaming yields the same words however the input is split
+TEST(WordFileTest, StreamChunksMatchWholeBuffer) {
+	const std::string content = "headline, pusillanimous, Internet,\nstuff, arcane, so-called, by";
+	std::vector<std::string> expected;
+	forEachWord(content, [&expected](std::string_view word) { expected.emplace_back(word); });
+	ASSERT_EQ(expected.size(), 7u);
+	EXPECT_EQ(expected[3], "stuff");
+
+	for (std::size_t chunk : {1u, 3u, 7u, 64u}) {
+		std::istringstream stream(content);
+		std::vector<std::string> words;
+		forEachWordInStream(stream, [&words](std::string_view word) { words.emplace_back(word); }, chunk);
+		EXPECT_EQ(words, expected);
+	}
+}
+
+// Test that a parallel bulk build sets exactly the bits of a sequential one
+TEST(BloomFilterTest, ParallelBulkBuild) {
+	std::vector<std::string> words;
+	for (int i = 0; i < 20000; ++i) {
+		words.push_back("bulk" + std::to_string(i));
+	}
+
+	auto sequential = std::make_unique<BloomFilter<1 << 16>>(4);
+	for (const auto& word : words) {
+		sequential->add(word);
+	}
+	auto parallel = std::make_unique<BloomFilter<1 << 16>>(4);
+	parallel->addAll(words, 4);
+
+	std::vector<std::string> probes = words;
+	for (int i = 0; i < 5000; ++i) {
+		probes.push_back("probe" + std::to_string(i));
+	}
+	std::vector<std::string_view> views(probes.begin(), probes.end());
+	EXPECT_EQ(parallel->possiblyContainsBatch(views), sequential->possiblyContainsBatch(views));
+	EXPECT_TRUE(parallel->certainlyContains("bulk19999"));
+
+	// The parallel file overload reads the same words as the sequential one
+	std::ofstream file("temp_bulk_words.txt");
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		file << (i ? ", " : "") << words[i];
+	}
+	file.close();
+	auto from_file = std::make_unique<BloomFilter<1 << 16>>(4);
+	EXPECT_EQ(from_file->addFile("temp_bulk_words.txt", true, 3), words.size());
+	EXPECT_EQ(from_file->possiblyContainsBatch(views), sequential->possiblyContainsBatch(views));
+	EXPECT_TRUE(from_file->certainlyContains("bulk42"));
+	std::remove("temp_bulk_words.txt");
+}
+
+// Test the saturation statistics and the union and intersection size estimates
+TEST(BloomFilterTest, CardinalityEstimates) {
+	auto filter1 = std::make_unique<BloomFilter<1 << 16>>(4);
+	auto filter2 = std::make_unique<BloomFilter<1 << 16>>(4);
+	EXPECT_EQ(filter1->bitCount(), 0u);
+	EXPECT_DOUBLE_EQ(filter1->estimatedCount(), 0.0);
+	EXPECT_DOUBLE_EQ(filter1->estimatedFalsePositiveRate(), 0.0);
+
+	// 3000 items in each filter, 1000 of them shared
+	for (int i = 0; i < 3000; ++i) {
+		filter1->add("item" + std::to_string(i));
+		filter2->add("item" + std::to_string(i + 2000));
+	}
+	EXPECT_LE(filter1->bitCount(), 3000u * 4);
+	EXPECT_NEAR(filter1->fillRatio(), static_cast<double>(filter1->bitCount()) / (1 << 16), 1e-12);
+	EXPECT_NEAR(filter1->estimatedCount(), 3000.0, 3000.0 * 0.05);
+	EXPECT_NEAR(filter2->estimatedCount(), 3000.0, 3000.0 * 0.05);
+	EXPECT_NEAR(filter1->estimatedUnionSize(*filter2), 5000.0, 5000.0 * 0.05);
+	EXPECT_NEAR(filter1->estimatedIntersectionSize(*filter2), 1000.0, 1000.0 * 0.3);
+
+	// The predicted false-positive rate matches the measured one
+	std::size_t false_positives = 0;
+	for (int i = 0; i < 20000; ++i) {
+		false_positives += filter1->possiblyContains("absent" + std::to_string(i));
+	}
+	EXPECT_NEAR(static_cast<double>(false_positives) / 20000, filter1->estimatedFalsePositiveRate(), 0.01);
+
+	BloomFilter<1 << 16> other_hashes(3);
+	EXPECT_THROW(filter1->estimatedUnionSize(other_hashes), std::invalid_argument);
+
+	// Saturated filters intersect with everything rather than with nothing
+	BloomFilter<64> full1(2);
+	BloomFilter<64> full2(2);
+	BloomFilter<64> sparse(2);
+	for (int i = 0; i < 2000; ++i) {
+		full1.add("full" + std::to_string(i));
+		full2.add("other" + std::to_string(i));
+	}
+	sparse.add("full0");
+	ASSERT_EQ(full1.bitCount(), 64u);
+	ASSERT_EQ(full2.bitCount(), 64u);
+	EXPECT_TRUE(std::isinf(full1.estimatedIntersectionSize(full2)));
+	EXPECT_DOUBLE_EQ(full1.estimatedIntersectionSize(sparse), sparse.estimatedCount());
+	EXPECT_DOUBLE_EQ(sparse.estimatedIntersectionSize(full1), sparse.estimatedCount());
+}
+
+// Test binary save/load and answering queries from a memory-mapped file
+TEST(BloomFilterTest, BinarySaveAndLoad) {
+	for (HashScheme scheme : {HashScheme::DoubleHashing, HashScheme::Seeded}) {
+		BloomFilter<4096> filter(3, scheme);
+		for (int i = 0; i < 200; ++i) {
+			filter.add("saved" + std::to_string(i));
+		}
+		filter.save("temp_filter.bin");
+
+		BloomFilter<4096> loaded = BloomFilter<4096>::load("temp_filter.bin");
+		MappedBloomFilter<4096> mapped("temp_filter.bin");
+		EXPECT_EQ(loaded.hashScheme(), scheme);
+		EXPECT_EQ(mapped.hashScheme(), scheme);
+		EXPECT_EQ(mapped.numHashes(), 3u);
+		for (int i = 0; i < 400; ++i) {
+			const std::string word = (i < 200 ? "saved" : "other") + std::to_string(i);
+			EXPECT_EQ(loaded.possiblyContains(word), filter.possiblyContains(word));
+			EXPECT_EQ(mapped.possiblyContains(word), filter.possiblyContains(word));
+		}
+	}
+
+	// A file written for another N is rejected
+	EXPECT_THROW(BloomFilter<8192>::load("temp_filter.bin"), std::runtime_error);
+	EXPECT_THROW(MappedBloomFilter<8192>("temp_filter.bin"), std::runtime_error);
+
+	// A corrupted bit word fails the checksum
+	{
+		std::fstream file("temp_filter.bin", std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(-1, std::ios::end);
+		file.put('\x5a');
+	}
+	EXPECT_THROW(BloomFilter<4096>::load("temp_filter.bin"), std::runtime_error);
+	EXPECT_THROW(MappedBloomFilter<4096>("temp_filter.bin"), std::runtime_error);
+	EXPECT_NO_THROW(MappedBloomFilter<4096>("temp_filter.bin", false));
+
+	EXPECT_THROW(BloomFilter<4096>::load("no_such_filter.bin"), std::runtime_error);
+	std::remove("temp_filter.bin");
+}
+
+// Several filters definitively checking against one shared backend
+TEST(BloomFilterTest, SharedBackend) {
+	auto server = std::make_shared<CDNServer>();
+	BloomFilter<> fruits(3, server);
+	DynamicBloomFilter colors(100, 0.01, server);
+	fruits.add("apple");
+	colors.add("red");
+
+	EXPECT_EQ(fruits.backend(), colors.backend());
+	EXPECT_TRUE(fruits.certainlyContains("apple"));
+	EXPECT_TRUE(colors.certainlyContains("red"));
+	EXPECT_FALSE(fruits.certainlyContains("red"));  // Rejected by the filter, the backend is never asked
+	EXPECT_EQ(server->getUsageCount(), 2u);
+
+	BloomFilter<> copy(fruits);
+	EXPECT_EQ(copy.backend(), server);
+	BloomFilter<> unbacked(3, nullptr);
+	unbacked.add("apple");
+	EXPECT_TRUE(unbacked.possiblyContains("apple"));
+	EXPECT_FALSE(unbacked.certainlyContains("apple"));
+}
+
+// Backend whose checks only run when their answer is awaited, recording how many were issued by then
+class DeferredBackend : public LookupBackend {
+public:
+	void addWord(std::string_view word) override { server.addWord(word); }
+	bool checkWord(std::string_view word) override { return server.checkWord(word); }
+	std::future<bool> checkWordAsync(std::string word) override {
+		++issued;
+		return std::async(std::launch::deferred, [this, word = std::move(word)] {
+			issued_at_first_wait = std::max(issued_at_first_wait, issued);
+			return checkWord(word);
+		});
+	}
+
+	CDNServer server;
+	std::size_t issued = 0;
+	std::size_t issued_at_first_wait = 0;
+};
+
+// Test that batched definitive checks are all in flight before the first answer is awaited
+TEST(BloomFilterTest, AsyncCertainlyContains) {
+	auto backend = std::make_shared<DeferredBackend>();
+	BloomFilter<> filter(3, backend);
+	for (int i = 0; i < 10; ++i) {
+		filter.add("word" + std::to_string(i));
+	}
+
+	std::vector<std::string> words;
+	for (int i = 0; i < 20; ++i) {
+		words.push_back("word" + std::to_string(i));
+	}
+	const std::vector<std::string_view> views(words.begin(), words.end());
+	const std::vector<bool> result = filter.certainlyContainsBatch(views);
+	ASSERT_EQ(result.size(), words.size());
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		EXPECT_EQ(result[i], i < 10) << words[i];
+	}
+	EXPECT_GE(backend->issued, 10u);
+	EXPECT_EQ(backend->issued_at_first_wait, backend->issued);
+
+	std::future<bool> present = filter.certainlyContainsAsync("word3");
+	std::future<bool> absent = filter.certainlyContainsAsync("word15");
+	EXPECT_TRUE(present.get());
+	EXPECT_FALSE(absent.get());
+}
+
+// Test that a cache between the filter and the server keeps repeated false positives off the server
+TEST(BloomFilterTest, CachedBackend) {
+	auto server = std::make_shared<CDNServer>();
+	auto cache = std::make_shared<CachedBackend>(server, 2);
+	BloomFilter<> filter(3, cache);
+	filter.add("apple");
+	filter.add("banana");
+
+	for (int i = 0; i < 10; ++i) {
+		EXPECT_TRUE(filter.certainlyContains("apple"));
+		EXPECT_TRUE(filter.certainlyContains("banana"));
+	}
+	EXPECT_EQ(server->getUsageCount(), 2u);
+	EXPECT_EQ(cache->misses(), 2u);
+	EXPECT_EQ(cache->hits(), 18u);
+
+	// A cached negative answer is corrected when the word is added
+	EXPECT_FALSE(cache->checkWord("cherry"));
+	filter.add("cherry");
+	EXPECT_TRUE(filter.certainlyContains("cherry"));
+	EXPECT_EQ(cache->size(), 2u);
+
+	// "apple" was the least recently used answer and has been evicted
+	const std::size_t before = server->getUsageCount();
+	std::future<bool> evicted = cache->checkWordAsync("apple");
+	std::future<bool> cached = cache->checkWordAsync("cherry");
+	EXPECT_TRUE(evicted.get());
+	EXPECT_TRUE(cached.get());
+	EXPECT_EQ(server->getUsageCount(), before + 1);
+
+	// An answer still pending is cached even if its future is dropped unawaited. Answers are cached in
+	// the order they were issued, so one awaited after it tells that it is there
+	auto slow = std::make_shared<DeferredBackend>();
+	slow->addWord("date");
+	auto slow_cache = std::make_unique<CachedBackend>(slow, 4);
+	{
+		const std::future<bool> dropped = slow_cache->checkWordAsync("date");
+	}
+	EXPECT_FALSE(slow_cache->checkWordAsync("elderberry").get());
+	EXPECT_EQ(slow_cache->size(), 2u);
+	EXPECT_TRUE(slow_cache->checkWord("date"));
+	EXPECT_EQ(slow->server.getUsageCount(), 2u);
+	// Destroying the cache waits for the answers still pending
+	std::future<bool> orphan = slow_cache->checkWordAsync("fig");
+	slow_cache.reset();
+	EXPECT_FALSE(orphan.get());
+}
+
+// Backend whose asynchronous answers are held back until the test releases them
+class ManualBackend : public LookupBackend {
+public:
+	void addWord(std::string_view word) override { server.addWord(word); }
+	bool checkWord(std::string_view word) override { return server.checkWord(word); }
+	std::future<bool> checkWordAsync(std::string word) override {
+		held.emplace_back(server.checkWord(word), std::promise<bool>());
+		return held.back().second.get_future();
+	}
+	// Delivers every held answer as it was when its check was issued
+	void release() {
+		for (auto& [answer, promise] : held) {
+			promise.set_value(answer);
+		}
+		held.clear();
+	}
+
+	CDNServer server;
+	std::vector<std::pair<bool, std::promise<bool>>> held;
+};
+
+// Test that a word added while a check of it is pending is not cached as absent by the late answer
+TEST(BloomFilterTest, CachedBackendAddWins) {
+	auto manual = std::make_shared<ManualBackend>();
+	CachedBackend cache(manual, 8);
+	std::future<bool> stale = cache.checkWordAsync("grape");
+	std::future<bool> unrelated = cache.checkWordAsync("kiwi");
+	cache.addWord("grape");
+	manual->release();
+	EXPECT_FALSE(stale.get());  // The answer from before the add is still returned
+	EXPECT_FALSE(unrelated.get());
+	EXPECT_TRUE(cache.checkWord("grape"));
+	EXPECT_EQ(cache.misses(), 3u);  // "grape" was not cached as absent and went to the server again
+	EXPECT_FALSE(cache.checkWord("kiwi"));
+	EXPECT_EQ(cache.hits(), 1u);
+}
+
+// Test memory accounting of a filter and of the server behind it
+TEST(BloomFilterTest, MemoryUsage) {
+	auto server = std::make_shared<CDNServer>();
+	BloomFilter<8192> filter(4, server);
+	const MemoryUsage bits = filter.memoryUsage();
+	EXPECT_EQ(bits.nodes, 8192u / 64);
+	EXPECT_GE(bits.live_bytes, 8192u / 8);
+	EXPECT_LE(bits.live_bytes, bits.allocated_bytes);
+	EXPECT_DOUBLE_EQ(filter.RAMUsage(), static_cast<double>(bits.allocated_bytes) / 1024.0);
+
+	const MemoryUsage before = server->memoryUsage();
+	filter.add("short");
+	filter.add("short");
+	const MemoryUsage one = server->memoryUsage();
+	EXPECT_EQ(one.nodes, 1u);
+	EXPECT_EQ(one.live_bytes, 5u);
+	// The set allocates a node even for a word held in the small-string buffer
+	EXPECT_GT(one.allocated_bytes, before.allocated_bytes);
+
+	const std::string long_word(1000, 'x');
+	filter.add(long_word);
+	const MemoryUsage two = server->memoryUsage();
+	EXPECT_EQ(two.nodes, 2u);
+	EXPECT_EQ(two.live_bytes, 1005u);
+	EXPECT_GE(two.allocated_bytes, one.allocated_bytes + 1000);
+	EXPECT_DOUBLE_EQ(server->RAMUsage(), static_cast<double>(two.allocated_bytes) / 1024.0);
+
+	// Copies and moves keep the words, the usage count and their own accounting
+	EXPECT_TRUE(server->checkWord("short"));
+	CDNServer copy(*server);
+	EXPECT_TRUE(copy.checkWord(long_word));
+	EXPECT_EQ(copy.getUsageCount(), 2u);
+	EXPECT_EQ(server->getUsageCount(), 1u);
+	EXPECT_EQ(copy.memoryUsage().nodes, 2u);
+	EXPECT_EQ(copy.memoryUsage().live_bytes, 1005u);
+	copy.addWord("extra");
+	EXPECT_EQ(server->memoryUsage().allocated_bytes, two.allocated_bytes);
+
+	CDNServer moved(std::move(copy));
+	EXPECT_TRUE(moved.checkWord("extra"));
+	EXPECT_EQ(moved.memoryUsage().nodes, 3u);
+	EXPECT_EQ(copy.memoryUsage().nodes, 0u);
+	copy = *server;
+	EXPECT_TRUE(copy.checkWord("short"));
+	EXPECT_FALSE(copy.checkWord("extra"));
+	copy = std::move(moved);
+	EXPECT_TRUE(copy.checkWord("extra"));
+	EXPECT_EQ(copy.memoryUsage().live_bytes, 1010u);
+}
+
+// ====================== BLOCKED BLOOM FILTER TESTS ======================
+
+// Fraction of "probes" (none of which were added) that the filter reports as possibly present
+template <typename Filter>
+double measuredFalsePositiveRate(const Filter& filter, const std::vector<std::string>& probes) {
+	std::size_t positives = 0;
+	for (const auto& probe : probes) {
+		positives += filter.possiblyContains(probe);
+	}
+	return static_cast<double>(positives) / static_cast<double>(probes.size());
+}
+
+// Test basic operations of the blocked layout
+TEST(BlockedBloomFilterTest, BasicOperations) {
+	BlockedBloomFilter<1024, 3> filter;
+	EXPECT_FALSE(filter.possiblyContains("test"));
+
+	filter.add("test");
+	EXPECT_TRUE(filter.possiblyContains("test"));
+	EXPECT_TRUE(filter("test"));
+	EXPECT_TRUE(filter.certainlyContains("test"));
+	EXPECT_FALSE(filter.certainlyContains("not_added"));
+
+	BlockedBloomFilter<1024, 3> copy(filter);
+	EXPECT_TRUE(copy.possiblyContains("test"));
+
+	filter.reset();
+	EXPECT_FALSE(filter.possiblyContains("test"));
+}
+
+// Test union and intersection of blocked filters
+TEST(BlockedBloomFilterTest, CombineOperators) {
+	BlockedBloomFilter<2048, 4> filter1;
+	filter1.add("common");
+	filter1.add("only_in_filter1");
+
+	BlockedBloomFilter<2048, 4> filter2;
+	filter2.add("common");
+	filter2.add("only_in_filter2");
+
+	BlockedBloomFilter<2048, 4> intersection = filter1;
+	intersection &= filter2;
+	EXPECT_TRUE(intersection.possiblyContains("common"));
+
+	BlockedBloomFilter<2048, 4> result = filter1 | filter2;
+	EXPECT_TRUE(result.possiblyContains("common"));
+	EXPECT_TRUE(result.possiblyContains("only_in_filter1"));
+	EXPECT_TRUE(result.possiblyContains("only_in_filter2"));
+}
+
+// Measure the false-positive rate of the blocked layout against the classic one
+TEST(BlockedBloomFilterTest, FalsePositiveRateAgainstClassic) {
+	constexpr std::size_t bits = 65536;
+	constexpr std::size_t hashes = 4;
+	auto classic = std::make_unique<BloomFilter<bits>>(hashes);
+	auto blocked = std::make_unique<BlockedBloomFilter<bits, hashes>>();
+
+	for (int i = 0; i < 5000; ++i) {
+		const std::string word = "present" + std::to_string(i);
+		classic->add(word);
+		blocked->add(word);
+	}
+	std::vector<std::string> probes;
+	for (int i = 0; i < 20000; ++i) {
+		probes.push_back("absent" + std::to_string(i));
+	}
+
+	const double classic_fpr = measuredFalsePositiveRate(*classic, probes);
+	const double blocked_fpr = measuredFalsePositiveRate(*blocked, probes);
+	RecordProperty("classic_fpr", std::to_string(classic_fpr));
+	RecordProperty("blocked_fpr", std::to_string(blocked_fpr));
+	std::cout << "FPR classic: " << classic_fpr << ", blocked: " << blocked_fpr << std::endl;
+
+	// Blocking costs some accuracy, but stays in the same order of magnitude
+	EXPECT_LT(classic_fpr, 0.02);
+	EXPECT_LT(blocked_fpr, 3 * classic_fpr + 0.005);
+}
+
+// Test that the probes inside a block reach every bit of it: with one block and one probe the rate must
+// match 1 - e^(-n / 512), rather than that of a block only half of whose bits can ever be hit
+TEST(BlockedBloomFilterTest, ProbesCoverWholeBlock) {
+	BlockedBloomFilter<512, 1> filter(nullptr);
+	constexpr int items = 200;
+	for (int i = 0; i < items; ++i) {
+		filter.add("present" + std::to_string(i));
+	}
+	std::vector<std::string> probes;
+	for (int i = 0; i < 20000; ++i) {
+		probes.push_back("absent" + std::to_string(i));
+	}
+	const double expected = 1.0 - std::exp(-static_cast<double>(items) / 512.0);
+	EXPECT_NEAR(measuredFalsePositiveRate(filter, probes), expected, 0.05);
+}
+
+// ====================== COUNTING BLOOM FILTER TESTS ======================
+
+// Test adding, counting and removing items
+TEST(CountingBloomFilterTest, AddAndRemove) {
+	CountingBloomFilter<4096> filter(3);
+	filter.add("apple");
+	filter.add("apple");
+	filter.add("banana");
+	EXPECT_GE(filter.count("apple"), 2u);
+	EXPECT_TRUE(filter.certainlyContains("banana"));
+
+	EXPECT_TRUE(filter.remove("apple"));
+	EXPECT_TRUE(filter.possiblyContains("apple"));  // Added twice, removed once
+	EXPECT_TRUE(filter.remove("apple"));
+	EXPECT_TRUE(filter.remove("banana"));
+	EXPECT_FALSE(filter.possiblyContains("apple"));
+	EXPECT_FALSE(filter.certainlyContains("banana"));
+	EXPECT_FALSE(filter.remove("banana"));
+
+	// Saturated counters stick, so the other items sharing them are never lost
+	CountingBloomFilter<64> tiny(2);
+	for (int i = 0; i < 200; ++i) {
+		tiny.add("item" + std::to_string(i));
+	}
+	for (int i = 0; i < 100; ++i) {
+		tiny.remove("item" + std::to_string(i));
+	}
+	for (int i = 100; i < 200; ++i) {
+		EXPECT_TRUE(tiny.possiblyContains("item" + std::to_string(i)));
+	}
+	// The removed items are gone from the backend, so their stuck counters are not confirmed
+	for (int i = 0; i < 100; ++i) {
+		EXPECT_FALSE(tiny.certainlyContains("item" + std::to_string(i)));
+	}
+}
+
+// Test that an item whose counter is kept up by another item is no longer confirmed after its removal
+TEST(CountingBloomFilterTest, RemoveWithSharedCounter) {
+	CountingBloomFilter<16> filter(1);
+	filter.add("first");
+	std::string other;
+	for (int i = 0; other.empty(); ++i) {
+		const std::string candidate = "other" + std::to_string(i);
+		if (filter.possiblyContains(candidate)) {
+			other = candidate;
+		}
+	}
+	filter.add(other);
+
+	EXPECT_TRUE(filter.remove("first"));
+	EXPECT_TRUE(filter.possiblyContains("first"));  // Its only counter is shared
+	EXPECT_FALSE(filter.certainlyContains("first"));
+	EXPECT_TRUE(filter.certainlyContains(other));
+
+	// A cache in front of the server forgets its answer too
+	auto cache = std::make_shared<CachedBackend>(std::make_shared<CDNServer>(), 8);
+	CountingBloomFilter<16> cached(1, cache);
+	cached.add("first");
+	cached.add(other);
+	EXPECT_TRUE(cached.certainlyContains("first"));
+	EXPECT_TRUE(cached.remove("first"));
+	EXPECT_FALSE(cached.certainlyContains("first"));
+	EXPECT_TRUE(cached.certainlyContains(other));
+}
+
+// Test that the compacted filter answers exactly like the counting one, for both schemes
+TEST(CountingBloomFilterTest, CompactToBloomFilter) {
+	for (HashScheme scheme : {HashScheme::DoubleHashing, HashScheme::Seeded}) {
+		CountingBloomFilter<4096> counting(4, scheme);
+		BloomFilter<4096> plain(4, scheme);
+		for (int i = 0; i < 300; ++i) {
+			counting.add("word" + std::to_string(i));
+			plain.add("word" + std::to_string(i));
+		}
+		for (int i = 0; i < 300; i += 2) {
+			counting.remove("word" + std::to_string(i));
+		}
+
+		BloomFilter<4096> compacted = counting.compact();
+		EXPECT_EQ(compacted.backend(), counting.backend());
+		EXPECT_NO_THROW(plain | compacted);  // Same hash functions as a directly built filter
+		for (int i = 0; i < 600; ++i) {
+			const std::string word = "word" + std::to_string(i);
+			EXPECT_EQ(compacted.possiblyContains(word), counting.possiblyContains(word)) << word;
+		}
+	}
+}
+
+// ====================== DYNAMIC BLOOM FILTER TESTS ======================
+
+// Test that dimensions are derived from the expected item count and target rate
+TEST(DynamicBloomFilterTest, OptimalDimensions) {
+	DynamicBloomFilter filter(1000, 0.01);
+
+	// m = -n ln(p) / ln(2)^2 ~ 9586 bits and k = m / n ln(2) ~ 7
+	EXPECT_GE(filter.numBits(), 9585u);
+	EXPECT_LE(filter.numBits(), 9600u);
+	EXPECT_EQ(filter.numHashes(), 7u);
+
+	DynamicBloomFilter fixed = DynamicBloomFilter::withDimensions(4096, 3);
+	EXPECT_EQ(fixed.numBits(), 4096u);
+	EXPECT_EQ(fixed.numHashes(), 3u);
+
+	EXPECT_THROW(DynamicBloomFilter(1000, 1.5), std::invalid_argument);
+}
+
+// Test basic operations and the false-positive rate at the planned load
+TEST(DynamicBloomFilterTest, BasicOperations) {
+	DynamicBloomFilter filter(2000, 0.01);
+	EXPECT_FALSE(filter.possiblyContains("test"));
+
+	for (int i = 0; i < 2000; ++i) {
+		filter.add("present" + std::to_string(i));
+	}
+	for (int i = 0; i < 2000; ++i) {
+		EXPECT_TRUE(filter.possiblyContains("present" + std::to_string(i)));
+	}
+	EXPECT_TRUE(filter.certainlyContains("present7"));
+	EXPECT_FALSE(filter.certainlyContains("absent"));
+
+	std::size_t false_positives = 0;
+	for (int i = 0; i < 10000; ++i) {
+		false_positives += filter.possiblyContains("absent" + std::to_string(i));
+	}
+	EXPECT_LT(false_positives, 200u);  // Target is 1%, allow for variance
+
+	// Moving only hands over the heap storage
+	DynamicBloomFilter moved(std::move(filter));
+	EXPECT_TRUE(moved.possiblyContains("present0"));
+
+	// The moved-from filter takes adds again, with a fresh minimal bit array and no backend
+	EXPECT_FALSE(filter.possiblyContains("present0"));
+	filter.add("again");
+	EXPECT_EQ(filter.numBits(), 512u);
+	EXPECT_TRUE(filter.possiblyContains("again"));
+	EXPECT_FALSE(filter.certainlyContains("again"));
+
+	DynamicBloomFilter other(2000, 0.01);
+	other.add("other");
+	moved |= other;
+	EXPECT_TRUE(moved.possiblyContains("other"));
+
+	moved.reset();
+	EXPECT_FALSE(moved.possiblyContains("present0"));
+}
+
+// Test that the scalable filter chains sub-filters and keeps its false-positive rate bounded
+TEST(ScalableBloomFilterTest, GrowsPastPlannedCapacity) {
+	ScalableBloomFilter filter(100, 0.01);
+	EXPECT_EQ(filter.stageCount(), 1u);
+
+	for (int i = 0; i < 3000; ++i) {
+		filter.add("present" + std::to_string(i));
+	}
+	EXPECT_GT(filter.stageCount(), 1u);
+	EXPECT_LE(filter.size(), 3000u);
+	for (int i = 0; i < 3000; ++i) {
+		EXPECT_TRUE(filter.possiblyContains("present" + std::to_string(i)));
+	}
+	EXPECT_TRUE(filter.certainlyContains("present42"));
+
+	std::size_t false_positives = 0;
+	for (int i = 0; i < 10000; ++i) {
+		false_positives += filter.possiblyContains("absent" + std::to_string(i));
+	}
+	EXPECT_LT(false_positives, 200u);
+
+	filter.reset();
+	EXPECT_EQ(filter.stageCount(), 1u);
+	EXPECT_FALSE(filter.possiblyContains("present0"));
+
+	// A moved-from filter is left without stages and takes adds again
+	ScalableBloomFilter moved(std::move(filter));
+	filter.add("again");
+	EXPECT_EQ(filter.stageCount(), 1u);
+	EXPECT_TRUE(filter.possiblyContains("again"));
+}
+
+// ====================== CONCURRENT BLOOM FILTER TESTS ======================
+
+// Test that inserts from several threads are all visible once the threads are joined
+TEST(ConcurrentBloomFilterTest, ParallelInsertAndQuery) {
+	auto filter = std::make_unique<ConcurrentBloomFilter<1 << 16>>(4);
+	constexpr int threads = 4;
+	constexpr int per_thread = 1000;
+	// Appended piece by piece, as GCC 12 at -O3 flags chained operator+ with -Werror=restrict
+	const auto key = [](int t, int i) {
+		std::string word = "t";
+		word += std::to_string(t);
+		word += '_';
+		word += std::to_string(i);
+		return word;
+	};
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t) {
+		workers.emplace_back([&filter, key, t] {
+			for (int i = 0; i < per_thread; ++i) {
+				const std::string word = key(t, i);
+				filter->add(word);
+				// Queries interleave with other threads' inserts
+				EXPECT_TRUE(filter->possiblyContains(word));
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	for (int t = 0; t < threads; ++t) {
+		for (int i = 0; i < per_thread; ++i) {
+			EXPECT_TRUE((*filter)(key(t, i)));
+		}
+	}
+
+	ConcurrentBloomFilter<1 << 16> snapshot(*filter);
+	EXPECT_TRUE(snapshot.possiblyContains("t0_0"));
+	filter->reset();
+	EXPECT_FALSE(filter->possiblyContains("t0_0"));
+	*filter |= snapshot;
+	EXPECT_TRUE(filter->possiblyContains("t0_0"));
+}
+
 // ====================== TRIE TESTS ======================
 
 // Test constructor and basic operations
@@ -247,6 +1089,120 @@ TEST(TrieTest, Remove) {
 	EXPECT_TRUE(trie.search("apple"));
 }
 
+// Test lookups through std::string_view
+TEST(TrieTest, StringViewLookups) {
+	Trie trie{"apple", "banana"};
+
+	const std::string buffer = "pineapple";
+	std::string_view apple = std::string_view(buffer).substr(4);
+	EXPECT_TRUE(trie.search(apple));
+	EXPECT_TRUE(trie(apple));
+	EXPECT_TRUE(trie.startsWith(apple.substr(0, 3)));
+	EXPECT_FALSE(trie.search(std::string_view(buffer).substr(0, 4)));
+	EXPECT_FALSE(trie.startsWith("Apple"));  // Characters outside a-z never match
+}
+
+// Test a dictionary-sized trie spanning many pool slabs through copies, removals and reinsertion
+TEST(TrieTest, LargeTrieCopyAndRemove) {
+	std::vector<std::string> words;
+	for (int i = 0; i < 5000; ++i) {
+		std::string word;
+		for (int n = i + 1; n > 0; n /= 26) {
+			word.push_back(static_cast<char>('a' + n % 26));
+		}
+		words.push_back(word + "x");
+	}
+	Trie original;
+	for (const std::string& word : words) {
+		original.insert(word);
+	}
+
+	Trie copy(original);
+	for (std::size_t i = 0; i < words.size(); i += 2) {
+		copy.remove(words[i]);
+	}
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		EXPECT_TRUE(original.search(words[i]));
+		EXPECT_EQ(copy.search(words[i]), i % 2 == 1);
+	}
+
+	// Freed nodes are reused by later inserts
+	for (std::size_t i = 0; i < words.size(); i += 2) {
+		copy.insert(words[i]);
+	}
+	EXPECT_EQ(copy, original);
+
+	Trie assigned;
+	assigned = copy;
+	Trie moved(std::move(copy));
+	EXPECT_EQ(assigned, moved);
+	EXPECT_FALSE(copy.search(words[1]));
+	copy.insert("again");
+	EXPECT_TRUE(copy.search("again"));
+}
+
+// Test words outside a-z
+TEST(TrieTest, FullByteAlphabet) {
+	Trie trie{"Internet", "so-called", "African-American", "caf\xc3\xa9"};
+	EXPECT_TRUE(trie.search("Internet"));
+	EXPECT_FALSE(trie.search("internet"));
+	EXPECT_TRUE(trie.search("so-called"));
+	EXPECT_TRUE(trie.startsWith("African-"));
+	EXPECT_TRUE(trie.search("caf\xc3\xa9"));
+	EXPECT_FALSE(trie.search("caf"));
+
+	// Bytes order unsigned, as in RadixTrie
+	std::ostringstream os;
+	os << trie;
+	EXPECT_EQ(os.str(), "African-American, Internet, caf\xc3\xa9, so-called");
+}
+
+// Test a node growing through every child layout and shrinking back
+TEST(TrieTest, GrowAndShrinkWideNode) {
+	std::vector<std::string> words;
+	for (int c = 255; c >= 1; --c) {
+		words.push_back(std::string("x") + static_cast<char>(c));
+	}
+	Trie trie;
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		trie.insert(words[i]);
+		// Every earlier sibling is still found after each change of layout
+		if (i == 4 || i == 16 || i == 48) {
+			for (std::size_t j = 0; j <= i; ++j) {
+				EXPECT_TRUE(trie.search(words[j]));
+			}
+		}
+	}
+	EXPECT_FALSE(trie.search("x"));
+
+	std::string order;
+	trie.dfs([&order](Trie::Node*& node) {
+		if (node->is_finished) {
+			order.push_back(node->data);
+		}
+	});
+	ASSERT_EQ(order.size(), 255u);
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		EXPECT_EQ(static_cast<unsigned char>(order[i]), i + 1);
+	}
+
+	// Remove from the middle so that the surviving keys have to be regrouped each time
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		if (i % 5 != 0) {
+			trie.remove(words[i]);
+		}
+	}
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		EXPECT_EQ(trie.search(words[i]), i % 5 == 0);
+	}
+	for (std::size_t i = 0; i < words.size(); i += 5) {
+		trie.remove(words[i]);
+	}
+	EXPECT_FALSE(trie.startsWith("x"));
+	trie.insert("xy");
+	EXPECT_TRUE(trie.search("xy"));
+}
+
 // Test BFS traversal
 TEST(TrieTest, BFSTraversal) {
 	Trie trie{"apple", "banana", "app"};
@@ -388,3 +1344,915 @@ TEST(TrieTest, DFSTraversal) {
 		EXPECT_NE(std::find(visited.begin(), visited.end(), c), visited.end());
 	}
 }
+
+// Test the template traversals, including skipping a subtree
+TEST(TrieTest, TemplateVisitors) {
+	Trie trie{"ab", "ac", "b", "bcd"};
+
+	std::string bfs_order;
+	trie.visit_bfs([&bfs_order](Trie::Node*& node) {
+		if (node->data != '\0') {
+			bfs_order.push_back(node->data);
+		}
+	});
+	EXPECT_EQ(bfs_order, "abbccd");
+
+	std::string dfs_order;
+	std::string std_function_order;
+	trie.visit_dfs([&dfs_order](Trie::Node*& node) {
+		if (node->data != '\0') {
+			dfs_order.push_back(node->data);
+		}
+	});
+	trie.dfs([&std_function_order](Trie::Node*& node) {
+		if (node->data != '\0') {
+			std_function_order.push_back(node->data);
+		}
+	});
+	EXPECT_EQ(dfs_order, "abcbcd");
+	EXPECT_EQ(std_function_order, dfs_order);
+
+	// Clearing the pointer prunes the walk below that node
+	std::string pruned;
+	trie.visit_dfs([&pruned](Trie::Node*& node) {
+		pruned.push_back(node->data ? node->data : '^');
+		if (node->data == 'a') {
+			node = nullptr;
+		}
+	});
+	EXPECT_EQ(pruned, "^abcd");
+}
+
+// Test that equality depends on the words only, not on how the tries were built
+TEST(TrieTest, StructuralEquality) {
+	Trie forward{"alpha", "alps", "beta"};
+	Trie backward;
+	backward.insert("beta");
+	backward.insert("alphabet");
+	backward.insert("alps");
+	backward.insert("alpha");
+	EXPECT_NE(forward, backward);
+	backward.remove("alphabet");
+	EXPECT_EQ(forward, backward);
+
+	backward.insert("alp");
+	EXPECT_NE(forward, backward);
+	backward.remove("alp");
+	EXPECT_EQ(forward, backward);
+
+	Trie moved(std::move(backward));
+	Trie emptied{"x"};
+	emptied.remove("x");
+	EXPECT_EQ(backward, Trie());
+	EXPECT_EQ(emptied, backward);
+	EXPECT_NE(moved, backward);
+
+	// Self union and difference
+	moved += moved;
+	EXPECT_EQ(moved, forward);
+	moved -= moved;
+	EXPECT_EQ(moved, Trie());
+}
+
+// Test union and difference against a set of the same words, for every value category
+TEST(TrieTest, StructuralSetAlgebra) {
+	std::set<std::string> left_words;
+	std::set<std::string> right_words;
+	Trie left;
+	Trie right;
+	for (int i = 0; i < 3000; ++i) {
+		std::string word;
+		for (int n = i * 7 + 1; n > 0; n /= 11) {
+			word.push_back(static_cast<char>('a' + n % 11));
+		}
+		if (i % 3 != 0) {
+			left.insert(word);
+			left_words.insert(word);
+		}
+		if (i % 2 == 0) {
+			right.insert(word);
+			right_words.insert(word);
+		}
+	}
+	const auto wordsOf = [](const Trie& trie) {
+		std::set<std::string> words;
+		for (const std::string& word : trie.withPrefix("")) {
+			words.insert(word);
+		}
+		return words;
+	};
+	std::set<std::string> united = left_words;
+	united.insert(right_words.begin(), right_words.end());
+	std::set<std::string> difference;
+	std::set_difference(left_words.begin(), left_words.end(), right_words.begin(), right_words.end(),
+	                    std::inserter(difference, difference.end()));
+
+	EXPECT_EQ(wordsOf(left + right), united);
+	EXPECT_EQ(wordsOf(left - right), difference);
+	EXPECT_EQ(wordsOf(Trie(left) + right), united);
+	EXPECT_EQ(wordsOf(left + Trie(right)), united);
+	EXPECT_EQ(wordsOf(Trie(left) + Trie(right)), united);
+	EXPECT_EQ(wordsOf(Trie(left) - right), difference);
+	EXPECT_EQ(left + right, right + left);
+	EXPECT_EQ((left - right) + right, left + right);
+
+	// The operands of the lvalue overloads are untouched
+	EXPECT_EQ(wordsOf(left), left_words);
+	EXPECT_EQ(wordsOf(right), right_words);
+
+	// Difference prunes what it empties, so equality with a freshly built trie still holds
+	Trie rebuilt;
+	for (const std::string& word : difference) {
+		rebuilt.insert(word);
+	}
+	EXPECT_EQ(left - right, rebuilt);
+	EXPECT_EQ((left - left), Trie());
+	EXPECT_EQ(Trie(left) - left, Trie());
+}
+
+// Test that difference keeps the completion weights right
+TEST(TrieTest, DifferenceUpdatesWeights) {
+	Trie trie;
+	trie.insert("note", 10);
+	trie.insert("notebook", 90);
+	trie.insert("notation", 40);
+	trie -= Trie{"notebook", "absent"};
+
+	using Result = std::vector<std::pair<std::string, std::uint32_t>>;
+	EXPECT_EQ(trie.topK("no", 1), (Result{{"notation", 40}}));
+	EXPECT_FALSE(trie.startsWith("noteb"));
+	trie += Trie{"notebook"};
+	EXPECT_EQ(trie.weight("notebook"), 0u);
+	EXPECT_EQ(trie.topK("note", 2), (Result{{"note", 10}, {"notebook", 0}}));
+}
+
+// Test the parallel bulk build against word-by-word insertion
+TEST(TrieTest, ParallelBulkBuild) {
+	std::vector<std::string> words{""};
+	for (int i = 0; i < 30000; ++i) {
+		std::string word;
+		for (unsigned n = static_cast<unsigned>(i) * 2654435761u; n > 0; n /= 37) {
+			word.push_back(static_cast<char>('0' + n % 37 * 2));
+		}
+		words.push_back(word);
+	}
+	// One wide node deep inside a subtree, so that every children layout is spliced
+	for (int c = 1; c < 256; ++c) {
+		words.push_back(std::string("0w") + static_cast<char>(c));
+	}
+
+	Trie sequential;
+	for (const std::string& word : words) {
+		sequential.insert(word);
+	}
+	for (unsigned int threads : {1u, 2u, 5u}) {
+		Trie built = Trie::fromWords(words, threads);
+		EXPECT_EQ(built, sequential);
+		EXPECT_TRUE(built.search(""));
+		for (std::size_t i = 0; i < words.size(); i += 97) {
+			EXPECT_TRUE(built.search(words[i]));
+		}
+
+		// The spliced trie keeps working as any other
+		for (std::size_t i = 0; i < words.size(); i += 2) {
+			built.remove(words[i]);
+		}
+		for (std::size_t i = 0; i < words.size(); i += 2) {
+			built.insert(words[i]);
+		}
+		EXPECT_EQ(built, sequential);
+	}
+
+	std::vector<std::string_view> views(words.begin(), words.end());
+	EXPECT_EQ(Trie::fromWords(views, 3), sequential);
+	EXPECT_EQ(Trie::fromWords(std::vector<std::string>{}, 4), Trie());
+
+	// An exception thrown inside a worker reaches the caller once every worker has finished
+	const std::thread::id caller = std::this_thread::get_id();
+	const auto failing = std::views::iota(std::size_t{0}, words.size())
+		| std::views::transform([&words, caller](std::size_t i) -> std::string_view {
+			if (std::this_thread::get_id() != caller && i == words.size() / 2) {
+				throw std::runtime_error("worker failure");
+			}
+			return words[i];
+		});
+	EXPECT_THROW(Trie::fromWords(failing, 3), std::runtime_error);
+
+	{
+		std::ofstream file("temp_trie_words.txt");
+		file << "alpha, beta, gamma, alp";
+	}
+	EXPECT_EQ(Trie::fromFile("temp_trie_words.txt", 2), (Trie{"alpha", "beta", "gamma", "alp"}));
+	std::remove("temp_trie_words.txt");
+	EXPECT_THROW(Trie::fromFile("no_such_words.txt"), std::runtime_error);
+}
+
+// Test the binary dump round trip through streams and files, weights included
+TEST(TrieTest, BinarySaveAndLoad) {
+	Trie trie{"apple", "app", "banana", ""};
+	trie.insert(std::string("b\xff\x01", 3));
+	for (int i = 0; i < 2000; ++i) {
+		trie.insert("word-" + std::to_string(i));
+	}
+	std::stringstream stream;
+	trie.save(stream);
+	const Trie loaded = Trie::load(stream);
+	EXPECT_EQ(loaded, trie);
+	EXPECT_TRUE(loaded.search(""));
+	EXPECT_TRUE(loaded.search(std::string("b\xff\x01", 3)));
+	EXPECT_FALSE(loaded.search("ap"));
+
+	// The text format still works and holds the same words
+	std::stringstream text;
+	text << loaded;
+	Trie reread;
+	text >> reread;
+	EXPECT_TRUE(reread.search("word-1999"));
+
+	Trie weighted;
+	weighted.insert("car", 5);
+	weighted.insert("cart", 9);
+	weighted.insert("cat", 7);
+	weighted.insert("dog");
+	weighted.save("temp_trie.dump");
+	const Trie from_file = Trie::load("temp_trie.dump");
+	EXPECT_EQ(from_file, weighted);
+	EXPECT_EQ(from_file.weight("cart"), 9u);
+	EXPECT_EQ(from_file.topK("ca", 2), weighted.topK("ca", 2));
+
+	// A corrupted record fails the checksum, a truncated dump fails outright
+	{
+		std::fstream file("temp_trie.dump", std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(-5, std::ios::end);
+		file.put('\x31');
+	}
+	EXPECT_THROW(Trie::load("temp_trie.dump"), std::runtime_error);
+	std::string dump = stream.str();
+	std::stringstream truncated(dump.substr(0, dump.size() - 1));
+	EXPECT_THROW(Trie::load(truncated), std::runtime_error);
+	std::stringstream not_a_dump("apple, banana");
+	EXPECT_THROW(Trie::load(not_a_dump), std::runtime_error);
+	EXPECT_THROW(Trie::load("no_such_trie.dump"), std::runtime_error);
+	std::remove("temp_trie.dump");
+
+	// Empty and moved-from tries load as empty ones
+	Trie moved(std::move(trie));
+	std::stringstream empty;
+	trie.save(empty);
+	const Trie empty_loaded = Trie::load(empty);
+	EXPECT_EQ(empty_loaded, Trie());
+	EXPECT_TRUE(empty_loaded.startsWith(""));
+}
+
+// Test memory accounting as words come and go, and against the frozen form
+TEST(TrieTest, MemoryUsage) {
+	Trie trie;
+	const MemoryUsage empty = trie.memoryUsage();
+	EXPECT_EQ(empty.nodes, 1u);
+	EXPECT_GE(empty.allocated_bytes, sizeof(Trie) + empty.live_bytes);
+
+	for (int i = 0; i < 1000; ++i) {
+		trie.insert("word-" + std::to_string(i));
+	}
+	const MemoryUsage full = trie.memoryUsage();
+	EXPECT_GT(full.nodes, 1000u);
+	EXPECT_GE(full.live_bytes, full.nodes * sizeof(Trie::Node));
+	EXPECT_LE(full.live_bytes, full.allocated_bytes);
+	EXPECT_GT(full.overheadPerNode(), 0.0);
+	EXPECT_DOUBLE_EQ(trie.RAMUsage(), static_cast<double>(full.allocated_bytes) / 1024.0);
+
+	// Pruned nodes stay allocated for reuse but are no longer live
+	for (int i = 0; i < 1000; ++i) {
+		trie.remove("word-" + std::to_string(i));
+	}
+	const MemoryUsage pruned = trie.memoryUsage();
+	EXPECT_EQ(pruned.nodes, 1u);
+	EXPECT_LT(pruned.live_bytes, full.live_bytes);
+	EXPECT_GE(pruned.allocated_bytes, full.allocated_bytes - full.live_bytes);
+
+	trie.insert("frozen");
+	const MemoryUsage frozen = trie.freeze().memoryUsage();
+	EXPECT_EQ(frozen.live_bytes, frozen.nodes * 8);
+	EXPECT_LE(frozen.live_bytes, frozen.allocated_bytes);
+}
+
+// Test lazy prefix enumeration
+TEST(TrieTest, WithPrefix) {
+	Trie trie{"car", "card", "care", "careful", "cart", "cat", "dog", "ca"};
+
+	std::vector<std::string> words;
+	for (const std::string& word : trie.withPrefix("car")) {
+		words.push_back(word);
+	}
+	EXPECT_EQ(words, (std::vector<std::string>{"car", "card", "care", "careful", "cart"}));
+
+	words.clear();
+	for (const std::string& word : trie.withPrefix("ca", 3)) {
+		words.push_back(word);
+	}
+	EXPECT_EQ(words, (std::vector<std::string>{"ca", "car", "card"}));
+
+	const auto range = trie.withPrefix("");
+	EXPECT_EQ(std::ranges::distance(range.begin(), range.end()), 8);
+	EXPECT_TRUE(trie.withPrefix("x").begin() == std::default_sentinel);
+	EXPECT_TRUE(trie.withPrefix("car", 0).begin() == std::default_sentinel);
+
+	// Wide nodes are walked in byte order too
+	Trie wide;
+	for (int c = 200; c >= 1; --c) {
+		wide.insert(std::string("p") + static_cast<char>(c));
+	}
+	int expected = 1;
+	for (const std::string& word : wide.withPrefix("p")) {
+		EXPECT_EQ(static_cast<unsigned char>(word[1]), expected++);
+	}
+	EXPECT_EQ(expected, 201);
+}
+
+// Test weighted top-k completion
+TEST(TrieTest, TopK) {
+	Trie trie;
+	trie.insert("apple", 50);
+	trie.insert("application", 80);
+	trie.insert("apply", 20);
+	trie.insert("apt", 90);
+	trie.insert("banana", 100);
+	trie.insert("app");
+
+	using Result = std::vector<std::pair<std::string, std::uint32_t>>;
+	EXPECT_EQ(trie.topK("ap", 3), (Result{{"apt", 90}, {"application", 80}, {"apple", 50}}));
+	EXPECT_EQ(trie.topK("", 1), (Result{{"banana", 100}}));
+	EXPECT_EQ(trie.topK("app", 10),
+	          (Result{{"application", 80}, {"apple", 50}, {"apply", 20}, {"app", 0}}));
+	EXPECT_TRUE(trie.topK("zzz", 3).empty());
+	EXPECT_EQ(trie.weight("apt"), 90u);
+	EXPECT_EQ(trie.weight("app"), 0u);
+	EXPECT_EQ(trie.weight("ap"), 0u);
+
+	// Lowering, removing and re-adding words keeps the subtree maxima right
+	trie.insert("apt", 10);
+	trie.remove("application");
+	EXPECT_EQ(trie.topK("ap", 2), (Result{{"apple", 50}, {"apply", 20}}));
+	trie.insert("application");
+	EXPECT_EQ(trie.weight("application"), 0u);
+	trie.insert("applause", 70);
+	EXPECT_EQ(trie.topK("appl", 1), (Result{{"applause", 70}}));
+
+	// Weights follow copies and moves
+	Trie copy(trie);
+	Trie moved(std::move(trie));
+	EXPECT_EQ(copy.topK("", 2), (Result{{"banana", 100}, {"applause", 70}}));
+	EXPECT_EQ(moved.topK("", 2), copy.topK("", 2));
+
+	// Without any weights the shortest words come first
+	Trie plain{"abc", "a", "ab"};
+	EXPECT_EQ(plain.topK("", 2), (Result{{"a", 0}, {"ab", 0}}));
+}
+
+// Test that every union overload merges weights the same way, a word of both keeping the larger one
+TEST(TrieTest, TopKAfterUnion) {
+	Trie left;
+	left.insert("apple", 50);
+	left.insert("apply", 10);
+	left.insert("banana", 30);
+	Trie right;
+	right.insert("apple", 20);
+	right.insert("apply", 70);
+	right.insert("cherry", 40);
+	right.insert("apricot");
+
+	using Result = std::vector<std::pair<std::string, std::uint32_t>>;
+	const Result expected{{"apply", 70}, {"apple", 50}, {"cherry", 40}, {"banana", 30}, {"apricot", 0}};
+	EXPECT_EQ((left + right).topK("", 10), expected);
+	EXPECT_EQ((right + left).topK("", 10), expected);
+	EXPECT_EQ((Trie(left) + right).topK("", 10), expected);
+	EXPECT_EQ((left + Trie(right)).topK("", 10), expected);
+	EXPECT_EQ((Trie(left) + Trie(right)).topK("", 10), expected);
+	EXPECT_EQ((Trie(right) + Trie(left)).topK("", 10), expected);
+	Trie sum(left);
+	sum += right;
+	EXPECT_EQ(sum.topK("", 10), expected);
+	EXPECT_EQ(sum.topK("ap", 1), (Result{{"apply", 70}}));
+
+	// Weights survive a union with a trie that has none, on either side
+	const Trie plain{"apple", "zebra"};
+	const Result with_plain{{"apple", 50}, {"banana", 30}, {"apply", 10}, {"zebra", 0}};
+	EXPECT_EQ((left + plain).topK("", 10), with_plain);
+	EXPECT_EQ((plain + left).topK("", 10), with_plain);
+	EXPECT_EQ((Trie(plain) + Trie(left)).topK("", 10), with_plain);
+}
+
+// ====================== RADIX TRIE TESTS ======================
+
+// Number of nodes reachable from the root, the root included
+std::size_t radixNodeCount(RadixTrie& trie) {
+	std::size_t count = 0;
+	trie.bfs([&count](RadixTrie::Node*&) { ++count; });
+	return count;
+}
+
+// Test that edges are split and chains stay compressed
+TEST(RadixTrieTest, BasicOperations) {
+	RadixTrie trie;
+	EXPECT_FALSE(trie.search("apple"));
+
+	trie.insert("apple");
+	EXPECT_EQ(radixNodeCount(trie), 2u);  // The whole word is a single edge
+	trie.insert("applet");
+	trie.insert("apply");
+	trie.insert("Zebra-Crossing");  // Any character can be stored
+
+	EXPECT_TRUE(trie.search("apple"));
+	EXPECT_TRUE(trie.search("applet"));
+	EXPECT_TRUE(trie("apply"));
+	EXPECT_TRUE(trie.search("Zebra-Crossing"));
+	EXPECT_FALSE(trie.search("appl"));
+	EXPECT_FALSE(trie.search("applets"));
+	EXPECT_TRUE(trie.startsWith("app"));
+	EXPECT_TRUE(trie.startsWith("apple"));
+	EXPECT_TRUE(trie.startsWith("Zebra-"));
+	EXPECT_FALSE(trie.startsWith("apples"));
+	EXPECT_FALSE(trie.startsWith("b"));
+	EXPECT_TRUE(trie.startsWith(""));
+
+	std::stringstream out;
+	out << trie;
+	EXPECT_EQ(out.str(), "Zebra-Crossing, apple, applet, apply");
+}
+
+// Test that removing words merges the chains they leave behind
+TEST(RadixTrieTest, RemoveRecompresses) {
+	RadixTrie trie{"apple", "applet", "apply", "banana"};
+	const std::size_t before = radixNodeCount(trie);
+
+	trie.remove("apply");
+	trie.remove("apple");
+	trie.remove("missing");
+	EXPECT_TRUE(trie.search("applet"));
+	EXPECT_FALSE(trie.search("apple"));
+	EXPECT_FALSE(trie.search("apply"));
+	EXPECT_TRUE(trie.startsWith("appl"));
+	EXPECT_LT(radixNodeCount(trie), before);
+	EXPECT_EQ(radixNodeCount(trie), 3u);  // Root, "applet" and "banana"
+
+	std::vector<std::string> labels;
+	trie.dfs([&labels](RadixTrie::Node*& node) { labels.push_back(node->label); });
+	EXPECT_EQ(labels, (std::vector<std::string>{"", "applet", "banana"}));
+
+	trie.remove("applet");
+	trie.remove("banana");
+	EXPECT_EQ(radixNodeCount(trie), 1u);
+	EXPECT_EQ(trie, RadixTrie());
+}
+
+// Test copies, moves, set operators and stream input against a plain Trie
+TEST(RadixTrieTest, OperatorsMatchTrie) {
+	std::string input;
+	for (int i = 0; i < 2000; ++i) {
+		std::string word;
+		for (int n = i * 7919 % 5003 + 1; n > 0; n /= 26) {
+			word.push_back(static_cast<char>('a' + n % 26));
+		}
+		input += (i ? ", " : "") + word;
+	}
+	std::stringstream radix_in(input);
+	std::stringstream plain_in(input);
+	RadixTrie radix;
+	Trie plain;
+	radix_in >> radix;
+	plain_in >> plain;
+	EXPECT_FALSE(radix_in.fail());
+
+	std::stringstream radix_out;
+	std::stringstream plain_out;
+	radix_out << radix;
+	plain_out << plain;
+	EXPECT_EQ(radix_out.str(), plain_out.str());
+
+	RadixTrie copy(radix);
+	RadixTrie evens;
+	for (int i = 0; i < 5003; i += 2) {
+		std::string word;
+		for (int n = i + 1; n > 0; n /= 26) {
+			word.push_back(static_cast<char>('a' + n % 26));
+		}
+		evens.insert(word);
+	}
+	RadixTrie difference = copy - evens;
+	RadixTrie united = difference + evens;
+	EXPECT_EQ(copy, radix);
+	EXPECT_EQ(united, radix + evens);
+	for (int i = 0; i < 5003; i += 2) {
+		std::string word;
+		for (int n = i + 1; n > 0; n /= 26) {
+			word.push_back(static_cast<char>('a' + n % 26));
+		}
+		EXPECT_FALSE(difference.search(word));
+	}
+
+	RadixTrie moved(std::move(copy));
+	EXPECT_EQ(moved, radix);
+	EXPECT_FALSE(copy.search("a"));
+	copy = moved;
+	EXPECT_EQ(copy, radix);
+}
+
+// ====================== FROZEN TRIE TESTS ======================
+
+// Test that a frozen trie answers exactly as the trie it was frozen from
+TEST(FrozenTrieTest, FreezeMatchesTrie) {
+	Trie trie{"apple", "app", "application", "banana", "band", "so-called", "Internet", "caf\xc3\xa9"};
+	for (int i = 0; i < 2000; ++i) {
+		trie.insert("word" + std::to_string(i * 7));
+	}
+	const FrozenTrie frozen = trie.freeze();
+	EXPECT_EQ(frozen.size(), 2008u);
+
+	for (const std::string query : {"apple", "app", "ap", "application", "applications", "band", "ban", "bandana",
+	                               "so-called", "so", "Internet", "internet", "caf", "caf\xc3\xa9", "", "zzz"}) {
+		EXPECT_EQ(frozen.search(query), trie.search(query)) << query;
+		EXPECT_EQ(frozen.startsWith(query), trie.startsWith(query)) << query;
+	}
+	for (int i = 0; i < 14000; ++i) {
+		const std::string word = "word" + std::to_string(i);
+		EXPECT_EQ(frozen(word), trie.search(word)) << word;
+	}
+
+	// Freezing an empty trie gives one that knows no word
+	Trie empty;
+	const FrozenTrie frozen_empty = empty.freeze();
+	EXPECT_EQ(frozen_empty.size(), 0u);
+	EXPECT_FALSE(frozen_empty.search(""));
+	EXPECT_TRUE(frozen_empty.startsWith(""));
+	EXPECT_FALSE(frozen_empty.startsWith("a"));
+}
+
+// Test saving a frozen trie and serving it from a memory-mapped file
+TEST(FrozenTrieTest, SaveAndMap) {
+	Trie trie;
+	for (int i = 0; i < 3000; ++i) {
+		trie.insert("key-" + std::to_string(i * 3));
+	}
+	trie.freeze().save("temp_trie.bin");
+
+	{
+		FrozenTrie mapped("temp_trie.bin");
+		EXPECT_EQ(mapped.size(), 3000u);
+		for (int i = 0; i < 9000; ++i) {
+			const std::string word = "key-" + std::to_string(i);
+			EXPECT_EQ(mapped.search(word), i % 3 == 0) << word;
+		}
+		EXPECT_TRUE(mapped.startsWith("key-2"));
+		FrozenTrie moved(std::move(mapped));
+		EXPECT_TRUE(moved.search("key-8997"));
+	}
+
+	// A corrupted slot fails the checksum
+	{
+		std::fstream file("temp_trie.bin", std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(-3, std::ios::end);
+		file.put('\x5a');
+	}
+	EXPECT_THROW(FrozenTrie("temp_trie.bin"), std::runtime_error);
+	EXPECT_NO_THROW(FrozenTrie("temp_trie.bin", false));
+
+	EXPECT_THROW(FrozenTrie("no_such_trie.bin"), std::runtime_error);
+	std::remove("temp_trie.bin");
+}
+
+// ====================== CONCURRENT TRIE TESTS ======================
+
+// Test the single-threaded behaviour matches Trie, including pruning on remove
+TEST(ConcurrentTrieTest, BasicOperations) {
+	ConcurrentTrie trie{"apple", "app", "banana"};
+	EXPECT_TRUE(trie.search("apple"));
+	EXPECT_TRUE(trie("app"));
+	EXPECT_FALSE(trie.search("ap"));
+	EXPECT_TRUE(trie.startsWith("ban"));
+	EXPECT_TRUE(trie.startsWith(""));
+	EXPECT_FALSE(trie.search(""));
+
+	trie.insert("");
+	trie.insert("band");
+	trie.insert("band"); // Already there: nothing is copied or retired
+	EXPECT_TRUE(trie.search(""));
+	EXPECT_TRUE(trie.search("band"));
+
+	trie.remove("banana");
+	EXPECT_FALSE(trie.search("banana"));
+	EXPECT_FALSE(trie.startsWith("bana"));
+	EXPECT_TRUE(trie.search("band"));
+	trie.remove("app");
+	EXPECT_FALSE(trie.search("app"));
+	EXPECT_TRUE(trie.search("apple"));
+	trie.remove("apple");
+	EXPECT_FALSE(trie.startsWith("a"));
+	trie.remove("");
+	trie.remove("missing");
+	EXPECT_FALSE(trie.search(""));
+
+	// Replaced nodes wait for a grace period, which passes at once with no reader around
+	EXPECT_GT(trie.retiredCount(), 0u);
+	trie.synchronize();
+	EXPECT_EQ(trie.retiredCount(), 0u);
+	EXPECT_TRUE(trie.search("band"));
+
+	Trie source{"cat", "car", "dog"};
+	const ConcurrentTrie copy(source);
+	EXPECT_TRUE(copy.search("car"));
+	EXPECT_TRUE(copy.search("dog"));
+	EXPECT_FALSE(copy.search("ca"));
+}
+
+// Test lock-free readers racing a writer: stable words are always found, and removed nodes are
+// freed only after the readers that could see them are done
+TEST(ConcurrentTrieTest, ReadersDuringUpdates) {
+	ConcurrentTrie trie;
+	constexpr int stable = 500;
+	for (int i = 0; i < stable; ++i) {
+		trie.insert("stable-" + std::to_string(i));
+	}
+
+	std::atomic<bool> done{false};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 3; ++t) {
+		readers.emplace_back([&trie, &done, t] {
+			int i = t;
+			while (!done.load()) {
+				EXPECT_TRUE(trie.search("stable-" + std::to_string(i % stable)));
+				trie.search("churn-" + std::to_string(i % 200));
+				EXPECT_TRUE(trie.startsWith("stable-"));
+				++i;
+			}
+		});
+	}
+	for (int round = 0; round < 20; ++round) {
+		for (int i = 0; i < 200; ++i) {
+			trie.insert("churn-" + std::to_string(i));
+		}
+		for (int i = 0; i < 200; ++i) {
+			trie.remove("churn-" + std::to_string(i));
+		}
+	}
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	trie.synchronize();
+	EXPECT_EQ(trie.retiredCount(), 0u);
+	EXPECT_FALSE(trie.startsWith("churn-"));
+	for (int i = 0; i < stable; ++i) {
+		EXPECT_TRUE(trie.search("stable-" + std::to_string(i)));
+	}
+}
+
+// ====================== LOOKUP PIPELINE TESTS ======================
+
+// Test that each tier only sees what the cheaper ones before it could not decide
+TEST(LookupPipelineTest, WordPipeline) {
+	auto server = std::make_shared<CDNServer>();
+	BloomFilter<8192> filter(3, nullptr);
+	Trie local{"apple", "banana"}; // Hot words held locally
+	for (const std::string word : {"apple", "banana", "cherry", "date"}) {
+		filter.add(word);
+		server->addWord(word);
+	}
+
+	LookupPipeline pipeline = LookupPipeline::words(filter, local, server);
+	EXPECT_TRUE(pipeline.contains("apple"));
+	EXPECT_TRUE(pipeline("banana"));
+	EXPECT_TRUE(pipeline.contains("cherry"));
+	EXPECT_TRUE(pipeline.contains("date"));
+	for (int i = 0; i < 100; ++i) {
+		EXPECT_FALSE(pipeline.contains("absent-" + std::to_string(i)));
+	}
+
+	const auto& stats = pipeline.stats();
+	ASSERT_EQ(stats.size(), 3u);
+	EXPECT_EQ(stats[0].name, "filter");
+	EXPECT_EQ(stats[0].hits() + stats[0].misses(), 104u);
+	const std::size_t rejected = stats[0].absent;
+	EXPECT_GT(rejected, 90u); // A false positive now and then is let through
+	EXPECT_EQ(stats[1].present, 2u);
+	EXPECT_EQ(stats[1].calls(), 104u - rejected);
+	EXPECT_EQ(stats[2].present, 2u);
+	EXPECT_EQ(stats[2].calls(), stats[1].misses());
+	EXPECT_EQ(server->getUsageCount(), stats[2].calls());
+
+	pipeline.resetStats();
+	EXPECT_EQ(pipeline.stats()[1].calls(), 0u);
+	EXPECT_EQ(pipeline.stats()[1].name, "dictionary");
+	EXPECT_FALSE(LookupPipeline().contains("apple"));
+}
+
+// Test the prefix pipeline and appending a custom stage
+TEST(LookupPipelineTest, PrefixPipeline) {
+	BloomFilter<8192> prefix_filter(3, nullptr);
+	const Trie trie{"car", "cart", "dog"};
+	for (const std::string word : {"car", "cart", "dog"}) {
+		LookupPipeline::addPrefixes(prefix_filter, word);
+	}
+
+	LookupPipeline pipeline = LookupPipeline::prefixes(prefix_filter, trie);
+	EXPECT_TRUE(pipeline.contains(""));
+	EXPECT_TRUE(pipeline.contains("ca"));
+	EXPECT_TRUE(pipeline.contains("do"));
+	EXPECT_TRUE(pipeline.contains("cart"));
+	EXPECT_FALSE(pipeline.contains("carts"));
+	for (int i = 0; i < 50; ++i) {
+		EXPECT_FALSE(pipeline.contains("x-" + std::to_string(i)));
+	}
+	ASSERT_EQ(pipeline.stats().size(), 2u);
+	EXPECT_GT(pipeline.stats()[0].absent, 40u);
+	EXPECT_EQ(pipeline.stats()[1].present, 4u);
+
+	// Prefixes the local trie does not know go to the remote check
+	const Trie empty;
+	LookupPipeline remote = LookupPipeline::prefixes(prefix_filter, empty, [](std::string_view prefix) {
+		return prefix == "do";
+	});
+	EXPECT_TRUE(remote.contains("do"));
+	EXPECT_FALSE(remote.contains("ca"));
+	EXPECT_EQ(remote.stats()[2].calls(), 2u);
+
+	int custom_calls = 0;
+	pipeline.then("custom", [&custom_calls](std::string_view) {
+		++custom_calls;
+		return LookupPipeline::Verdict::Present;
+	});
+	EXPECT_FALSE(pipeline.contains("zebra")); // The trie stage is final without a remote check
+	EXPECT_EQ(custom_calls, 0);
+}
+
+// ====================== LOOKUP STATS TESTS ======================
+
+// Test that every latency lands in a bucket whose range holds it to within 1/16
+TEST(LookupStatsTest, HistogramBuckets) {
+	using lookup_stats::Histogram;
+	for (std::uint64_t ns : {0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, (1ull << 40) - 1}) {
+		const std::size_t bucket = Histogram::bucketOf(ns);
+		ASSERT_LT(bucket, Histogram::num_buckets);
+		EXPECT_LE(Histogram::lowestOf(bucket), ns);
+		if (bucket + 1 < Histogram::num_buckets) {
+			EXPECT_LT(ns, Histogram::lowestOf(bucket + 1));
+		}
+		EXPECT_LE(ns - Histogram::lowestOf(bucket), ns / 16);
+	}
+	EXPECT_EQ(Histogram::bucketOf(1ull << 50), Histogram::num_buckets - 1);
+
+	Histogram histogram;
+	EXPECT_EQ(histogram.percentile(0.5), 0u);
+	histogram.counts[Histogram::bucketOf(100)] = 99;
+	histogram.counts[Histogram::bucketOf(5000)] = 1;
+	EXPECT_EQ(histogram.count(), 100u);
+	EXPECT_GE(histogram.percentile(0.5), 100u);
+	EXPECT_LT(histogram.percentile(0.99), 110u);
+	EXPECT_GE(histogram.percentile(1.0), 5000u);
+}
+
+// Test the counters of every instrumented class, summed over threads; all zero when compiled out
+TEST(LookupStatsTest, OperationCounters) {
+	using lookup_stats::Counter;
+	using lookup_stats::Timer;
+	lookup_stats::reset();
+
+	auto server = std::make_shared<CDNServer>();
+	BloomFilter<4096> filter(3, server);
+	Trie trie;
+	filter.add("apple");
+	trie.insert("apple");
+	std::thread worker([&] {
+		EXPECT_TRUE(filter.certainlyContains("apple"));
+		EXPECT_TRUE(trie.search("apple"));
+	});
+	worker.join();
+	int false_positives = 0;
+	for (int i = 0; i < 200; ++i) {
+		const std::string word = "missing-" + std::to_string(i);
+		false_positives += filter.possiblyContains(word);
+		EXPECT_FALSE(filter.certainlyContains(word));
+	}
+	EXPECT_TRUE(trie.startsWith("app"));
+	trie.remove("apple");
+
+	const lookup_stats::Snapshot stats = lookup_stats::snapshot();
+	if (!lookup_stats::enabled) {
+		EXPECT_EQ(stats[Counter::BloomAdd], 0u);
+		EXPECT_EQ(stats[Timer::TrieSearch].count(), 0u);
+		return;
+	}
+	EXPECT_EQ(stats[Counter::BloomAdd], 1u);
+	EXPECT_EQ(stats[Counter::ServerAddWord], 1u);
+	EXPECT_EQ(stats[Counter::ServerWordBytes], 5u);
+	EXPECT_EQ(stats[Counter::BloomCertainlyContains], 201u);
+	EXPECT_EQ(stats[Counter::BloomPossiblyContains], 401u);
+	EXPECT_EQ(stats[Counter::BloomFalsePositive], static_cast<std::uint64_t>(false_positives));
+	EXPECT_EQ(stats[Counter::ServerCheckWord], 1u + false_positives);
+	EXPECT_EQ(stats[Counter::ServerHit], 1u);
+	EXPECT_EQ(stats[Counter::TrieInsert], 1u);
+	EXPECT_EQ(stats[Counter::TrieNodesCreated], 6u); // The root and one per letter
+	EXPECT_EQ(stats[Counter::TrieNodesPruned], 5u);
+	EXPECT_EQ(stats[Counter::TrieSearch], 1u);
+	EXPECT_EQ(stats[Timer::TrieSearch].count(), 1u);
+	EXPECT_EQ(stats[Timer::BloomPossiblyContains].count(), 401u);
+	EXPECT_EQ(stats[Timer::TrieStartsWith].count(), 1u);
+}
+
+// ====================== SHARDED CDN SERVER TESTS ======================
+
+// Test adding and checking words through growth of the shard tables
+TEST(ShardedCDNServerTest, AddAndCheckWords) {
+	EXPECT_THROW(ShardedCDNServer(0), std::invalid_argument);
+	EXPECT_EQ(ShardedCDNServer(5).shardCount(), 8u);
+	EXPECT_EQ(ShardedCDNServer(1).shardCount(), 1u);
+
+	ShardedCDNServer server(4);
+	EXPECT_FALSE(server.checkWord(""));
+	for (int i = 0; i < 5000; ++i) {
+		server.addWord("word-" + std::to_string(i));
+	}
+	server.addWord("word-42");
+	server.addWord("");
+	EXPECT_EQ(server.size(), 5001u);
+	for (int i = 0; i < 5000; ++i) {
+		EXPECT_TRUE(server.checkWord("word-" + std::to_string(i)));
+		EXPECT_FALSE(server.checkWord("other-" + std::to_string(i)));
+	}
+	EXPECT_TRUE(server.checkWord(""));
+	EXPECT_EQ(server.getUsageCount(), 10002u);
+
+	const std::string word = "word-7";
+	EXPECT_TRUE(server.checkWord(word, hash128(word)));
+	EXPECT_LT(server.shardOf(word), server.shardCount());
+
+	const MemoryUsage usage = server.memoryUsage();
+	EXPECT_EQ(usage.nodes, 5001u);
+	EXPECT_GT(usage.allocated_bytes, usage.live_bytes);
+	EXPECT_DOUBLE_EQ(server.RAMUsage(), static_cast<double>(usage.allocated_bytes) / 1024.0);
+}
+
+// Test checkWord from several threads while another one keeps adding words
+TEST(ShardedCDNServerTest, ConcurrentChecks) {
+	ShardedCDNServer server(8);
+	for (int i = 0; i < 1000; ++i) {
+		server.addWord("stored-" + std::to_string(i));
+	}
+	std::atomic<int> wrong{0};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&] {
+			for (int i = 0; i < 2000; ++i) {
+				wrong += !server.checkWord("stored-" + std::to_string(i % 1000));
+				wrong += server.checkWord("absent-" + std::to_string(i));
+			}
+		});
+	}
+	std::thread writer([&] {
+		for (int i = 0; i < 3000; ++i) {
+			server.addWord("added-" + std::to_string(i));
+		}
+	});
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	writer.join();
+	EXPECT_EQ(wrong.load(), 0);
+	EXPECT_EQ(server.getUsageCount(), 16000u);
+	EXPECT_EQ(server.size(), 4000u);
+	EXPECT_TRUE(server.checkWord("added-2999"));
+}
+
+// Test that each filter shard holds exactly the items of the matching server shard
+TEST(ShardedCDNServerTest, ShardedBloomFilter) {
+	auto server = std::make_shared<ShardedCDNServer>(4);
+	ShardedBloomFilter<4096> filter(3, server);
+	EXPECT_EQ(filter.shardCount(), 4u);
+	EXPECT_THROW(ShardedBloomFilter<4096>(3, nullptr), std::invalid_argument);
+
+	const std::vector<std::string> words = {"apple", "banana", "cherry", "date", "elderberry", "fig", "grape"};
+	for (const std::string& word : words) {
+		filter.add(word);
+	}
+	EXPECT_EQ(server->size(), words.size());
+	for (const std::string& word : words) {
+		EXPECT_TRUE(filter.possiblyContains(word));
+		EXPECT_TRUE(filter(word));
+		EXPECT_TRUE(filter.certainlyContains(word));
+		EXPECT_TRUE(filter.shard(server->shardOf(word)).possiblyContains(word));
+	}
+	std::size_t bits = 0;
+	for (std::size_t s = 0; s < filter.shardCount(); ++s) {
+		bits += filter.shard(s).bitCount();
+	}
+	EXPECT_LE(bits, words.size() * 3);
+	EXPECT_FALSE(filter.certainlyContains("kiwi"));
+	EXPECT_EQ(filter.memoryUsage().nodes, 4 * filter.shard(0).memoryUsage().nodes);
+
+	// Plugs into the stock pipeline as filter and backend
+	Trie local{"apple"};
+	LookupPipeline pipeline = LookupPipeline::words(filter, local, server);
+	EXPECT_TRUE(pipeline("apple"));
+	EXPECT_TRUE(pipeline("grape"));
+	EXPECT_FALSE(pipeline("kiwi"));
+}